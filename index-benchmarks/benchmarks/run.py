@@ -50,7 +50,7 @@ class PiBenchExperiment:
     def run(self, ith, idx, total):
         commands = [*self.numactl, PiBenchExperiment.pibench_bin,
                     self.wrapper_bin, *self.pibench_args]
-        if 'stdrw' in self.index or 'mcsrw' in self.index:
+        if 'stdrw' in self.index or 'mcsrw' in self.index or 'crw' in self.index:
             commands.append('--bulk_load')
         print(f'Executing ({idx}/{total}):', ' '.join(commands))
         result_text = None
@@ -431,4 +431,104 @@ if __name__ == '__main__':
     run_all_experiments('scalability', 'Update-only-selfsimilar', indexes, labels, threads, records=NUM_RECORDS, seconds=SECONDS,
                         read_ratio=0.0, update_ratio=1.0, distribution='SELFSIMILAR', skew=0.2)
 
+    # combining: lock holders apply queued leaf writes
+    indexes = [
+        'btreeomcs_leaf_offset',
+        'btreeomcs_leaf_op_read',
+        'btreeomcs_leaf_offset_combining',
+        'btreeomcs_leaf_op_read_combining',
+    ]
+    labels = [
+        'B+-tree OptiQL-NOR',
+        'B+-tree OptiQL',
+        'B+-tree OptiQL-NOR Combining',
+        'B+-tree OptiQL Combining',
+    ]
+    threads = [1, 5, 10, 20, 30, 40, 50, 60, 70, 80]
+    # dense
+    run_all_experiments('combining', 'Update-only-selfsimilar', indexes, labels, threads, records=NUM_RECORDS, seconds=SECONDS,
+                        read_ratio=0.0, update_ratio=1.0, distribution='SELFSIMILAR', skew=0.2)
+    run_all_experiments('combining', 'Write-heavy-selfsimilar', indexes, labels, threads, records=NUM_RECORDS, seconds=SECONDS,
+                        read_ratio=0.2, update_ratio=0.8, distribution='SELFSIMILAR', skew=0.2)
+
+    # backoff policies for centralized locks and restarts (latches/Backoff.h)
+    indexes = [
+        'btreeolc_upgrade',
+        'btreeolc_upgrade_backoff_exp',
+        'btreeolc_upgrade_backoff_prop',
+        'btreeolc_upgrade_backoff_rand',
+        'artolc_upgrade',
+        'artolc_upgrade_backoff_exp',
+        'artolc_upgrade_backoff_prop',
+        'artolc_upgrade_backoff_rand',
+    ]
+    labels = [
+        'B+-tree OptLock',
+        'B+-tree OptLock Exp. Backoff',
+        'B+-tree OptLock Prop. Backoff',
+        'B+-tree OptLock Rand. Backoff',
+        'ART OptLock',
+        'ART OptLock Exp. Backoff',
+        'ART OptLock Prop. Backoff',
+        'ART OptLock Rand. Backoff',
+    ]
+    threads = [1, 5, 10, 20, 30, 40, 50, 60, 70, 80]
+    # dense
+    run_all_experiments('backoff', 'Update-only-selfsimilar', indexes, labels, threads, records=NUM_RECORDS, seconds=SECONDS,
+                        read_ratio=0.0, update_ratio=1.0, distribution='SELFSIMILAR', skew=0.2)
+    run_all_experiments('backoff', 'Write-heavy-selfsimilar', indexes, labels, threads, records=NUM_RECORDS, seconds=SECONDS,
+                        read_ratio=0.2, update_ratio=0.8, distribution='SELFSIMILAR', skew=0.2)
+
+    # ART obsolete flag in the lock word (OMCS_OBSOLETE_BIT)
+    indexes = [
+        'artolc_upgrade',
+        'artolc_upgrade_obsolete_bit',
+        'artomcs_offset',
+        'artomcs_offset_obsolete_bit',
+        'artomcs_op_read',
+        'artomcs_op_read_obsolete_bit',
+    ]
+    labels = [
+        'ART OptLock',
+        'ART OptLock Obsolete Bit',
+        'ART OptiQL-NOR',
+        'ART OptiQL-NOR Obsolete Bit',
+        'ART OptiQL',
+        'ART OptiQL Obsolete Bit',
+    ]
+    threads = [1, 5, 10, 20, 30, 40, 50, 60, 70, 80]
+    # dense
+    run_all_experiments('obsolete-bit', 'Read-only-selfsimilar', indexes, labels, threads, records=NUM_RECORDS, seconds=SECONDS,
+                        read_ratio=1.0, distribution='SELFSIMILAR', skew=0.2)
+    run_all_experiments('obsolete-bit', 'Balanced-selfsimilar', indexes, labels, threads, records=NUM_RECORDS, seconds=SECONDS,
+                        read_ratio=0.5, update_ratio=0.5, distribution='SELFSIMILAR', skew=0.2)
+
+    # reader bias for lock coupling (MCSRW_BRAVO)
+    indexes = [
+        'btreelc_mcsrw',
+        'btreelc_mcsrw_bravo',
+        'btreelc_crw_cwp',
+        'btreelc_crw_cwp_bravo',
+        'artlc_mcsrw',
+        'artlc_mcsrw_bravo',
+        'artlc_crw_cwp',
+        'artlc_crw_cwp_bravo',
+    ]
+    labels = [
+        'B+-tree MCSRW',
+        'B+-tree MCSRW BRAVO',
+        'B+-tree CRW-WP',
+        'B+-tree CRW-WP BRAVO',
+        'ART MCSRW',
+        'ART MCSRW BRAVO',
+        'ART CRW-WP',
+        'ART CRW-WP BRAVO',
+    ]
+    threads = [1, 5, 10, 20, 30, 40, 50, 60, 70, 80]
+    # dense
+    run_all_experiments('reader-bias', 'Read-only-selfsimilar', indexes, labels, threads, records=NUM_RECORDS, seconds=SECONDS,
+                        read_ratio=1.0, distribution='SELFSIMILAR', skew=0.2)
+    run_all_experiments('reader-bias', 'Read-heavy-selfsimilar', indexes, labels, threads, records=NUM_RECORDS, seconds=SECONDS,
+                        read_ratio=0.8, update_ratio=0.2, distribution='SELFSIMILAR', skew=0.2)
+
     dataframe.to_csv(os.path.join(data_dir, 'All.csv'))
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cpuid.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+/*
+ * Hardware performance counters of benchmark threads, read with
+ * perf_event_open.
+ *
+ * Each thread that calls start_thread() counts user-space cycles,
+ * instructions, last-level cache misses and, where the CPU has such an event,
+ * loads that hit a modified line in another socket's cache (remote HITM, the
+ * cost of coherence traffic across sockets). Counters that cannot be opened --
+ * no PMU access in a container, perf_event_paranoid too high, unknown CPU --
+ * are reported as unavailable; the benchmark runs as usual.
+ *
+ * The remote HITM event is known for Intel server CPUs from Skylake on; set
+ * PERF_REMOTE_HITM_EVENT to a raw event (e.g., 0x04d3: event 0xd3, umask 0x04)
+ * for others.
+ */
+namespace perf_counters {
+
+enum event : uint32_t { kCycles, kInstructions, kLLCMisses, kRemoteHITM, kNumEvents };
+
+inline constexpr const char *kEventNames[kNumEvents] = {"cycles", "instructions", "llc_misses",
+                                                        "remote_hitm"};
+
+// Raw config of MEM_LOAD_L3_MISS_RETIRED.REMOTE_HITM, or 0 if unknown
+inline uint64_t remote_hitm_config() {
+  if (const char *env = getenv("PERF_REMOTE_HITM_EVENT")) {
+    return strtoull(env, nullptr, 0);
+  }
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx) || ebx != signature_INTEL_ebx) {
+    return 0;
+  }
+  __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+  uint32_t family = (eax >> 8) & 0xf;
+  uint32_t model = ((eax >> 4) & 0xf) | ((eax >> 12) & 0xf0);
+  if (family != 6) {
+    return 0;
+  }
+  switch (model) {
+    case 0x55:  // Skylake-SP, Cascade Lake, Cooper Lake
+    case 0x6a:  // Ice Lake-SP
+    case 0x6c:
+    case 0x8f:  // Sapphire Rapids
+    case 0xcf:  // Emerald Rapids
+      return 0x04d3;
+    default:
+      return 0;
+  }
+}
+
+struct counts {
+  uint64_t values[kNumEvents] = {};
+  bool available[kNumEvents] = {};
+
+  counts &operator+=(const counts &other) {
+    for (uint32_t i = 0; i < kNumEvents; ++i) {
+      values[i] += other.values[i];
+      available[i] |= other.available[i];
+    }
+    return *this;
+  }
+};
+
+// Counters of one thread, counting from open() on
+class thread_counters {
+ public:
+  thread_counters() {
+    for (int &fd : fds_) {
+      fd = -1;
+    }
+  }
+
+  ~thread_counters() {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+
+  void open() {
+    open_event(kCycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    open_event(kInstructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    open_event(kLLCMisses, PERF_TYPE_HW_CACHE,
+               PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    static const uint64_t hitm = remote_hitm_config();
+    if (hitm) {
+      open_event(kRemoteHITM, PERF_TYPE_RAW, hitm);
+    }
+  }
+
+  // Values scaled up for the time the kernel multiplexed a counter out
+  counts read() const {
+    counts result;
+    for (uint32_t i = 0; i < kNumEvents; ++i) {
+      uint64_t data[3];  // Value, time enabled, time running
+      if (fds_[i] < 0 || ::read(fds_[i], data, sizeof(data)) != sizeof(data) || !data[2]) {
+        continue;
+      }
+      result.values[i] = data[1] == data[2] ? data[0] : data[0] * (double)data[1] / data[2];
+      result.available[i] = true;
+    }
+    return result;
+  }
+
+ private:
+  void open_event(event e, uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fds_[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  int fds_[kNumEvents];
+};
+
+// Counters of all threads that called start_thread(), never freed
+struct thread_state {
+  thread_counters counters;
+  uint64_t operations = 0;
+};
+
+inline std::mutex states_mutex;
+inline std::vector<thread_state *> states;
+
+inline thread_state *&local_state() {
+  static thread_local thread_state *state = nullptr;
+  return state;
+}
+
+// Starts counting for the calling thread, once
+inline void start_thread() {
+  if (local_state()) {
+    return;
+  }
+  auto *state = new thread_state();
+  state->counters.open();
+  local_state() = state;
+  std::lock_guard<std::mutex> guard(states_mutex);
+  states.push_back(state);
+}
+
+inline void count_operation() {
+  if (thread_state *state = local_state()) {
+    ++state->operations;
+  }
+}
+
+// Sums up the counters of all threads, and the operations they counted
+inline counts sum(uint64_t *operations = nullptr) {
+  counts result;
+  std::lock_guard<std::mutex> guard(states_mutex);
+  for (thread_state *state : states) {
+    result += state->counters.read();
+    if (operations) {
+      *operations += state->operations;
+    }
+  }
+  return result;
+}
+
+// One CSV line per event: total and per operation, "n/a" if unavailable
+inline void print(const counts &c, uint64_t operations, std::ostream &os = std::cout) {
+  os << "Counter,Total,PerOperation" << std::endl;
+  for (uint32_t i = 0; i < kNumEvents; ++i) {
+    os << kEventNames[i];
+    if (c.available[i]) {
+      os << "," << c.values[i] << "," << (operations ? c.values[i] / (double)operations : 0);
+    } else {
+      os << ",n/a,n/a";
+    }
+    os << std::endl;
+  }
+}
+
+}  // namespace perf_counters
+
+#ifdef PERF_COUNTERS
+#define PERF_COUNTERS_START_THREAD() perf_counters::start_thread()
+#define PERF_COUNTERS_OPERATION() perf_counters::count_operation()
+#else
+#define PERF_COUNTERS_START_THREAD()
+#define PERF_COUNTERS_OPERATION()
+#endif  // PERF_COUNTERS
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <fcntl.h>
+#include <immintrin.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#ifndef CACHELINE_SIZE
+#define CACHELINE_SIZE 64
+#endif
+
+#ifndef MAP_FIXED_NOREPLACE
+// Older headers; kernels before 4.17 take it as a hint, which is checked
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+// Fixed virtual address of the shared region in every process that maps it
+#ifndef SHM_REGION_ADDRESS
+#define SHM_REGION_ADDRESS 0x600000000000ull
+#endif
+
+/*
+ * A memory region shared by cooperating processes, for queue nodes, locks and
+ * index nodes that several worker processes operate on.
+ *
+ * The region is backed by a memfd (for fork()-based workers, which inherit the
+ * mapping) or a POSIX shared memory object (for unrelated processes, which
+ * attach by name), and is mapped at SHM_REGION_ADDRESS everywhere. Queue nodes
+ * are referred to by IDs in lock words anyway (OMCS_OFFSET); mapping at one
+ * address keeps every other pointer stored in the region (index nodes, the
+ * tree root) valid across processes as well.
+ *
+ *   |--header--|--------allocated-------->|-----------free-----------|
+ *
+ * Memory is handed out by bumping [used] and is never returned. Objects that
+ * other processes need to find (e.g., the index) are published in [roots].
+ */
+namespace shm {
+
+struct region_header {
+  static constexpr uint64_t kMagic = 0x4f7074694d534852ull;
+  static constexpr uint32_t kMaxRoots = 8;
+
+  uint64_t magic;
+  uint64_t size;
+  alignas(CACHELINE_SIZE) std::atomic<uint64_t> used;
+  alignas(CACHELINE_SIZE) std::atomic<void *> roots[kMaxRoots];
+};
+
+// Well-known root slots
+enum root : uint32_t { kQNodes = 0, kIndex = 1 };
+
+inline region_header *region = nullptr;
+
+// Lock for data shared by processes: futex-based std::mutex is process-private
+struct spin_mutex {
+  std::atomic<bool> locked{false};
+
+  void lock() {
+    while (locked.exchange(true, std::memory_order_acquire)) {
+      while (locked.load(std::memory_order_relaxed)) {
+        _mm_pause();
+      }
+    }
+  }
+
+  void unlock() { locked.store(false, std::memory_order_release); }
+};
+
+inline void *map_at_fixed_address(int fd, uint64_t size) {
+  void *base = reinterpret_cast<void *>(SHM_REGION_ADDRESS);
+  void *addr =
+      mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+  if (addr == MAP_FAILED || addr != base) {
+    perror("shm: cannot map the shared region at SHM_REGION_ADDRESS");
+    abort();
+  }
+  return addr;
+}
+
+// Creates and maps a region of [size] bytes. Without a [name] the region is
+// anonymous and only reaches processes fork()ed afterwards.
+inline void create(uint64_t size, const char *name = nullptr) {
+  if (region) {
+    return;
+  }
+  int fd = name ? shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600) : memfd_create("optiql", 0);
+  if (fd < 0 || ftruncate(fd, size) != 0) {
+    perror("shm: cannot create the shared region");
+    abort();
+  }
+  region = static_cast<region_header *>(map_at_fixed_address(fd, size));
+  close(fd);
+
+  region->magic = region_header::kMagic;
+  region->size = size;
+  region->used.store((sizeof(region_header) + CACHELINE_SIZE - 1) & ~(CACHELINE_SIZE - 1));
+  for (auto &r : region->roots) {
+    r.store(nullptr);
+  }
+}
+
+// Maps the region that another process created with [name]
+inline void attach(const char *name) {
+  if (region) {
+    return;
+  }
+  int fd = shm_open(name, O_RDWR, 0600);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    perror("shm: cannot open the shared region");
+    abort();
+  }
+  region = static_cast<region_header *>(map_at_fixed_address(fd, st.st_size));
+  close(fd);
+  if (region->magic != region_header::kMagic || region->size != static_cast<uint64_t>(st.st_size)) {
+    fprintf(stderr, "shm: %s is not a shared region\n", name);
+    abort();
+  }
+}
+
+inline bool enabled() { return region != nullptr; }
+
+inline void *allocate(uint64_t size, uint64_t alignment = CACHELINE_SIZE) {
+  uint64_t used = region->used.load(std::memory_order_relaxed);
+  uint64_t start;
+  do {
+    start = (used + alignment - 1) & ~(alignment - 1);
+    if (start + size > region->size) {
+      fprintf(stderr, "shm: out of memory in the shared region (%lu bytes)\n", region->size);
+      abort();
+    }
+  } while (!region->used.compare_exchange_weak(used, start + size));
+  return reinterpret_cast<char *>(region) + start;
+}
+
+template <class T, class... Args>
+inline T *make(Args &&...args) {
+  return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+inline void publish(root r, void *obj) { region->roots[r].store(obj, std::memory_order_release); }
+
+template <class T>
+inline T *lookup(root r) {
+  return static_cast<T *>(region->roots[r].load(std::memory_order_acquire));
+}
+
+}  // namespace shm
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <numa.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/*
+ * CPU topology of the host, read from sysfs and libnuma, for pinning benchmark
+ * threads. Only CPUs in the affinity mask the process started with (e.g., set
+ * by taskset or numactl) are used.
+ *
+ * Threads are placed on CPUs in the order of a policy:
+ *
+ *   compact:  fill one NUMA node after another, SMT siblings of a core next
+ *             to each other
+ *   scatter:  round-robin over NUMA nodes, one thread per core before any SMT
+ *             sibling
+ *   smt_last: fill one NUMA node after another with one thread per core, then
+ *             do the same with the SMT siblings (the default)
+ *
+ * Thread i runs on the (i mod number of CPUs)-th CPU of the order.
+ */
+namespace topology {
+
+enum class policy { kCompact, kScatter, kSmtLast };
+
+struct cpu {
+  int id;
+  int node;    // NUMA node
+  int socket;  // Physical package
+  int core;    // Core id within the package
+  int smt;     // Rank among the SMT siblings of the core
+};
+
+inline bool parse_policy(const std::string &name, policy &p) {
+  if (name == "compact") {
+    p = policy::kCompact;
+  } else if (name == "scatter") {
+    p = policy::kScatter;
+  } else if (name == "smt_last") {
+    p = policy::kSmtLast;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline int read_topology_value(int cpu_id, const char *name, int fallback) {
+  char path[128];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu_id, name);
+  FILE *f = fopen(path, "r");
+  int value;
+  if (!f || fscanf(f, "%d", &value) != 1) {
+    value = fallback;
+  }
+  if (f) {
+    fclose(f);
+  }
+  return value;
+}
+
+inline std::vector<cpu> discover() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  bool has_numa = numa_available() >= 0;
+
+  std::vector<cpu> cpus;
+  for (int id = 0; id < CPU_SETSIZE; ++id) {
+    if (!CPU_ISSET(id, &allowed)) {
+      continue;
+    }
+    int node = has_numa ? std::max(numa_node_of_cpu(id), 0) : 0;
+    cpus.push_back(cpu{id, node, read_topology_value(id, "physical_package_id", node),
+                       read_topology_value(id, "core_id", id), 0});
+  }
+
+  // SMT siblings share a package and a core id
+  for (auto &c : cpus) {
+    for (auto &other : cpus) {
+      c.smt += other.socket == c.socket && other.core == c.core && other.id < c.id;
+    }
+  }
+  return cpus;
+}
+
+inline std::vector<cpu> order(policy p, std::vector<cpu> cpus = discover()) {
+  auto by_core = [](const cpu &a, const cpu &b) {
+    return std::tie(a.node, a.socket, a.core, a.id) < std::tie(b.node, b.socket, b.core, b.id);
+  };
+  if (p == policy::kCompact) {
+    std::sort(cpus.begin(), cpus.end(), by_core);
+  } else if (p == policy::kSmtLast) {
+    std::sort(cpus.begin(), cpus.end(), [&](const cpu &a, const cpu &b) {
+      return a.smt != b.smt ? a.smt < b.smt : by_core(a, b);
+    });
+  } else {
+    // Rank of each CPU among the CPUs of its node with the same SMT rank;
+    // then the first of every node, the second of every node, ...
+    std::sort(cpus.begin(), cpus.end(), by_core);
+    std::map<std::pair<int, int>, int> ranks;
+    std::vector<std::tuple<int, int, int, uint32_t>> keys;  // smt, rank, node, index
+    for (uint32_t i = 0; i < cpus.size(); ++i) {
+      keys.emplace_back(cpus[i].smt, ranks[{cpus[i].smt, cpus[i].node}]++, cpus[i].node, i);
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<cpu> scattered;
+    for (auto &k : keys) {
+      scattered.push_back(cpus[std::get<3>(k)]);
+    }
+    cpus.swap(scattered);
+  }
+  return cpus;
+}
+
+// Placement of all threads of a benchmark. All policies are discovered on
+// first use, which must come before any thread is pinned (pinning narrows the
+// affinity mask discover() starts from).
+inline const std::vector<cpu> &placement(policy p) {
+  static const std::vector<cpu> orders[] = {order(policy::kCompact), order(policy::kScatter),
+                                            order(policy::kSmtLast)};
+  return orders[static_cast<int>(p)];
+}
+
+inline const cpu &cpu_of(uint32_t thread_id, policy p = policy::kSmtLast) {
+  const auto &cpus = placement(p);
+  return cpus[thread_id % cpus.size()];
+}
+
+// Pins the calling thread (or process) to the CPU of [thread_id]
+inline int pin(uint32_t thread_id, policy p = policy::kSmtLast) {
+  int id = cpu_of(thread_id, p).id;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(id, &set);
+  sched_setaffinity(0, sizeof(set), &set);
+  return id;
+}
+
+inline int node_of(uint32_t thread_id, policy p = policy::kSmtLast) {
+  return cpu_of(thread_id, p).node;
+}
+
+// NUMA node of the CPU the calling thread runs on. Benchmark threads are
+// pinned, so this is looked up once per thread.
+inline uint32_t current_node() {
+  thread_local int node = -1;
+  if (node < 0) {
+    node = std::max(numa_node_of_cpu(sched_getcpu()), 0);
+  }
+  return node;
+}
+
+}  // namespace topology
@@ -96,8 +96,7 @@ void N::insertGrow(curN *n, uint64_t v, N *parentNode, uint64_t parentVersion, u
 
   N::change(parentNode, keyParent, nBig);
 
-  n->setObsolete();
-  UNLOCK_NODE(n);
+  UNLOCK_OBSOLETE_NODE(n);
   obsoleteN = n;
   UNLOCK_PARENT();
 }
@@ -218,8 +217,7 @@ void N::removeAndShrink(curN *n, uint64_t v, N *parentNode, uint64_t parentVersi
   nSmall->remove(key);
   N::change(parentNode, keyParent, nSmall);
 
-  n->setObsolete();
-  UNLOCK_NODE(n);
+  UNLOCK_OBSOLETE_NODE(n);
   obsoleteN = n;
   UNLOCK_PARENT();
 }
@@ -12,6 +12,7 @@
 #include <atomic>
 
 #include "Key.h"
+#include "latches/Backoff.h"
 #include "latches/OMCS.h"
 #include "latches/OMCSOffset.h"
 
@@ -28,6 +29,7 @@ using TID = uint64_t;
 #define UPGRADE_PARENT() \
   parentNode->upgradeToWriteLockOrRestart(parentVersion, &parentQ, needRestart)
 #define UNLOCK_NODE(n) n->writeUnlock(&q)
+#define UNLOCK_OBSOLETE_NODE(n) n->writeUnlockObsolete(&q)
 #define UNLOCK_PARENT() parentNode->writeUnlock(&parentQ)
 #else
 #define DEFINE_CONTEXT(q, i)
@@ -35,6 +37,7 @@ using TID = uint64_t;
 #define UPGRADE_NODE(n) n->upgradeToWriteLockOrRestart(v, needRestart)
 #define UPGRADE_PARENT() parentNode->upgradeToWriteLockOrRestart(parentVersion, needRestart)
 #define UNLOCK_NODE(n) n->writeUnlock()
+#define UNLOCK_OBSOLETE_NODE(n) n->writeUnlockObsolete()
 #define UNLOCK_PARENT() parentNode->writeUnlock()
 #endif
 
@@ -69,10 +72,16 @@ class N {
   Lock lock;
 
   struct TaggedPrefixCount {
+#ifdef OMCS_OBSOLETE_BIT
+    // 2b type 30b prefixCount; the obsolete flag lives in the lock word
+    static const uint32_t kMaxPrefixCount = (1 << 30) - 1;
+    static const uint32_t kBitsMask = 0xC0000000;
+#else
     // 2b type 1b obsolete 29b prefixCount
     static const uint32_t kMaxPrefixCount = (1 << 29) - 1;
     static const uint32_t kObsoleteBit = 1 << 29;
     static const uint32_t kBitsMask = 0xE0000000;
+#endif
     static const uint32_t kTypeBitsMask = 0xC0000000;
 
     uint32_t value;
@@ -97,11 +106,13 @@ class N {
 
     uint32_t getRaw() const { return value; }
 
-    uint32_t getObsolete() const { return value & kObsoleteBit; }
-
     void setType(uint32_t type) { value = (value & (~kTypeBitsMask)) | type; }
 
+#ifndef OMCS_OBSOLETE_BIT
+    uint32_t getObsolete() const { return value & kObsoleteBit; }
+
     void setObsolete() { value |= kObsoleteBit; }
+#endif
   };
 
   TaggedPrefixCount prefixCount = 0;
@@ -124,6 +135,68 @@ class N {
 
   bool isLocked() const { return lock.isLocked(); }
 
+#ifdef OMCS_OBSOLETE_BIT
+  // The obsolete flag is part of the version: it is checked on the snapshot
+  // the caller already has, and validating a snapshot covers it
+  static inline void checkObsoleteOrRestart(uint64_t version, bool &needRestart) {
+    if (needRestart) {
+      return;
+    }
+    if (Lock::isObsolete(version)) {
+      needRestart = true;
+      return;
+    }
+  }
+
+  void writeLockOrRestart(bool &needRestart) {
+    uint64_t v = lock.writeLock();
+    checkObsoleteOrRestart(v, needRestart);
+    if (needRestart) {
+      lock.writeUnlock();
+    }
+  }
+
+  void upgradeToWriteLockOrRestart(uint64_t &version, bool &needRestart) {
+    // [version] passed checkObsoleteOrRestart() in readLockOrRestart()
+    lock.upgradeToWriteLockOrRestart(version, needRestart);
+  }
+
+  void writeUnlock() { lock.writeUnlock(); }
+
+  void writeUnlockObsolete() { lock.writeUnlockObsolete(); }
+
+  void writeLockOrRestart(Lock::Context *q, bool &needRestart) {
+    lock.writeLock(q);
+    if (!needRestart && Lock::isObsolete(q)) {
+      needRestart = true;
+    }
+    if (needRestart) {
+      lock.writeUnlock(q);
+    }
+  }
+
+  void upgradeToWriteLockOrRestart(uint64_t &version, Lock::Context *q, bool &needRestart) {
+    lock.upgradeToWriteLockOrRestart(version, q, needRestart);
+  }
+
+  void writeUnlock(Lock::Context *q) { lock.writeUnlock(q); }
+
+  void writeUnlockObsolete(Lock::Context *q) { lock.writeUnlockObsolete(q); }
+
+  uint64_t readLockOrRestart(bool &needRestart) const {
+    auto v = lock.readLockOrRestart(needRestart);
+    checkObsoleteOrRestart(v, needRestart);
+    return v;
+  }
+
+  void checkOrRestart(uint64_t startRead, bool &needRestart) const {
+    lock.checkOrRestart(startRead, needRestart);
+  }
+
+  void readUnlockOrRestart(uint64_t startRead, bool &needRestart) const {
+    lock.readUnlockOrRestart(startRead, needRestart);
+  }
+#else
   inline void checkObsoleteOrRestart(bool &needRestart) const {
     if (needRestart) {
       return;
@@ -156,6 +229,11 @@ class N {
     lock.writeUnlock();
   }
 
+  void writeUnlockObsolete() {
+    setObsolete();
+    lock.writeUnlock();
+  }
+
   void writeLockOrRestart(Lock::Context *q, bool &needRestart) {
     lock.writeLock(q);
     checkObsoleteOrRestart(needRestart);
@@ -178,6 +256,11 @@ class N {
     lock.writeUnlock(q);
   }
 
+  void writeUnlockObsolete(Lock::Context *q) {
+    setObsolete();
+    lock.writeUnlock(q);
+  }
+
   uint64_t readLockOrRestart(bool &needRestart) const {
     auto v = lock.readLockOrRestart(needRestart);
     checkObsoleteOrRestart(needRestart);
@@ -197,6 +280,7 @@ class N {
   bool isObsolete() const { return prefixCount.getObsolete(); }
 
   void setObsolete() { prefixCount.setObsolete(); }
+#endif
 
   static N *getChild(const uint8_t k, const N *node);
 
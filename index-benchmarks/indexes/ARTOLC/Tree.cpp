@@ -19,7 +19,9 @@ Tree::~Tree() {
 }
 
 TID Tree::lookup(const Key &k) const {
+  int restartCount = 0;
 restart:
+  restart_backoff(restartCount);
   bool needRestart = false;
 
   N *node;
@@ -248,7 +250,9 @@ bool Tree::lookupRange(const Key &start, const Key &end, Key &continueKey, TID r
         }
       };
 
+  int restartCount = 0;
 restart:
+  restart_backoff(restartCount);
   bool needRestart = false;
 
   resultsFound = 0;
@@ -422,7 +426,9 @@ bool Tree::lookupRange(const Key &start, TID result[], std::size_t resultSize,
         }
       };
 
+  int restartCount = 0;
 restart:
+  restart_backoff(restartCount);
   bool needRestart = false;
 
   resultsFound = 0;
@@ -500,7 +506,9 @@ TID Tree::checkKey(const TID tid, const Key &k) const {
 }
 
 bool Tree::insert(const Key &k, TID tid) {
+  int restartCount = 0;
 restart:
+  restart_backoff(restartCount);
   bool needRestart = false;
 
   N *node = nullptr;
@@ -618,7 +626,9 @@ bool Tree::traverseToLeafEx(const Key &k, OMCSLock::Context &q, N *&parentNode_o
 bool Tree::traverseToLeafEx(const Key &k, N *&parentNode_out, uint32_t &level_out,
                             bool &upgraded_out) {
 #endif
+  int restartCount = 0;
 restart:
+  restart_backoff(restartCount);
   bool needRestart = false;
 
   N *node;
@@ -720,7 +730,9 @@ bool Tree::traverseToLeafUpgradeEx(const Key &k, OMCSLock::Context &q, N *&paren
 #else
 bool Tree::traverseToLeafUpgradeEx(const Key &k, N *&parentNode_out, uint32_t &level_out) {
 #endif
+  int restartCount = 0;
 restart:
+  restart_backoff(restartCount);
   bool needRestart = false;
 
   N *node;
@@ -787,7 +799,9 @@ bool Tree::traverseToLeafAcquireEx(const Key &k, OMCSLock::Context qnodes[], N *
 #else
 bool Tree::traverseToLeafAcquireEx(const Key &k, N *&parentNode_out, uint32_t &level_out) {
 #endif
+  int restartCount = 0;
 restart:
+  restart_backoff(restartCount);
   bool needRestart = false;
 
   N *node;
@@ -1105,7 +1119,9 @@ bool Tree::update(const Key &k) {
 
 #ifdef ART_UPSERT
 bool Tree::upsert(const Key &k, TID tid) {
+  int restartCount = 0;
 restart:
+  restart_backoff(restartCount);
   bool needRestart = false;
 
   N *node = nullptr;
@@ -1215,7 +1231,9 @@ restart:
 #endif
 
 bool Tree::remove(const Key &k, TID tid) {
+  int restartCount = 0;
 restart:
+  restart_backoff(restartCount);
   bool needRestart = false;
 
   N *node = nullptr;
@@ -1277,8 +1295,7 @@ restart:
               N::change(parentNode, parentKey, secondNodeN);
 
               UNLOCK_PARENT();
-              node->setObsolete();
-              UNLOCK_NODE(node);
+              UNLOCK_OBSOLETE_NODE(node);
               this->removeNode(node);
             } else {
               DEFINE_CONTEXT(secondQ, 2);
@@ -1304,8 +1321,7 @@ restart:
               secondNodeN->writeUnlock();
 #endif
 
-              node->setObsolete();
-              UNLOCK_NODE(node);
+              UNLOCK_OBSOLETE_NODE(node);
               this->removeNode(node);
             }
           } else {
@@ -29,6 +29,12 @@ class Tree {
   RemoveNodeFunction removeNode;
   uniform_random_generator rng;
 
+  // Called at every restart: label; backs off once a pass has failed, with
+  // [restartCount] - 1 restarts so far (see latches/Backoff.h)
+  static inline void restart_backoff(int &restartCount) {
+    if (restartCount++) backoff::pause(restartCount - 1);
+  }
+
  public:
   enum class CheckPrefixResult : uint8_t { Match, NoMatch, OptimisticMatch };
 
@@ -9,8 +9,16 @@
 #include <iostream>
 #include <utility>
 
+#include "latches/Backoff.h"
+#include "latches/LockStats.h"
 #include "latches/OMCS.h"
 
+#if defined(BTREE_SHARED_MEMORY)
+// Nodes come from the region shared with other processes; the tree itself
+// should be created there as well (shm::make)
+#include "common/shared_region.h"
+#endif
+
 namespace btreeolc {
 
 enum class PageType : uint8_t { BTreeInner = 1, BTreeLeaf = 2 };
@@ -27,7 +35,11 @@ struct NodeBase : public OMCSLock {
   PageType getType() const { return (level == 1) ? PageType::BTreeLeaf : PageType::BTreeInner; }
 
   static void *operator new(std::size_t count) {
+#if defined(BTREE_SHARED_MEMORY)
+    void *space = shm::allocate(pageSize, pageSize);
+#else
     void *space = aligned_alloc(pageSize, pageSize);
+#endif
     return ::operator new(count, space);
   }
 };
@@ -265,9 +277,30 @@ struct BTreeBase {
     root = inner;
   }
 
+#if defined(LOCK_STATS)
+  // Level of the node a lock belongs to; the lock is at the start of each node.
+  // Install it as lock_stats::overflow_group before counting, so that locks
+  // that overflow the per-thread tables are still counted per level.
+  static uint32_t lockStatsLevel(const void *lock) {
+    return static_cast<const NodeBase *>(static_cast<const OMCSLock *>(lock))->level;
+  }
+
+  // Lock contention counters summed up per level (1: leaves), including the
+  // locks that overflowed the per-thread tables
+  static std::map<uint8_t, lock_stats::counts> lockStatsPerLevel() {
+    auto levels = lock_stats::aggregate(
+        [](const void *lock) { return static_cast<uint8_t>(lockStatsLevel(lock)); });
+    for (const auto &[level, stats] : lock_stats::overflowed()) {
+      levels[level] += stats;
+    }
+    return levels;
+  }
+#endif
+
   inline void yield(int count) {
-    (void)count;
     _mm_pause();
+    // [count] - 1 restarts so far; see latches/Backoff.h
+    backoff::pause(count - 1);
   }
 
 #if defined(BTREE_NO_SYNC)
@@ -371,7 +404,10 @@ struct BTreeBase {
       }
 
       if (count == range) {
-        // scan() finishes at [leaf]
+        // scan() finishes at [leaf], which must not have changed while
+        // we copied from it
+        leaf->checkOrRestart(versionNode, needRestart);
+        if (needRestart) goto restart;
         break;
       } else {
         // proceed with next leaf
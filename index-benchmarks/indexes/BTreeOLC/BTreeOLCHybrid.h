@@ -15,6 +15,7 @@
 #include <iostream>
 #include <utility>
 
+#include "latches/Backoff.h"
 #include "latches/OMCS.h"
 #include "latches/OMCSOffset.h"
 
@@ -316,8 +317,9 @@ struct BTreeOLCHybrid {
   }
 
   inline void yield(int count) {
-    (void)count;
     _mm_pause();
+    // [count] - 1 restarts so far; see latches/Backoff.h
+    backoff::pause(count - 1);
   }
 
   BTreeOLCHybrid() {
@@ -624,7 +626,10 @@ struct BTreeOLCHybrid {
       }
 
       if (count == range) {
-        // scan() finishes at [leaf]
+        // scan() finishes at [leaf], which must not have changed while
+        // we copied from it
+        leaf->checkOrRestart(versionNode, needRestart);
+        if (needRestart) goto restart;
         break;
       } else {
         // proceed with next leaf
@@ -24,6 +24,7 @@ struct BTreeOLC : public BTreeBase<Key, Value> {
     std::cout << "========================================" << std::endl;
     std::cout << "BTree with original optimistic locks (upgrade)." << std::endl;
     std::cout << "Optimistic lock impl: " << OMCSLock::name << std::endl;
+    std::cout << "Backoff policy: " << backoff::name << std::endl;
     std::cout << "Page size (bytes): " << pageSize << std::endl;
     std::cout << "Max #entries: Leaf: " << BTreeLeaf<Key, Value>::maxEntries
               << ", Inner: " << BTreeInner<Key>::maxEntries << std::endl;
@@ -11,6 +11,10 @@
 
 // This implementation uses OMCS only on leaf nodes.
 
+#if defined(OMCS_COMBINING) && (defined(OMCS_OP_READ_NEW_API) || defined(OMCS_OP_READ_NEW_API_CALLBACK))
+#error "OMCS_COMBINING does not support the new op-read APIs."
+#endif
+
 #if defined(OMCS_OFFSET)
 #define DEFINE_CONTEXT(q, i) OMCSLock::Context &q = *offset::get_qnode(i)
 #else
@@ -24,12 +28,15 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
   using BTreeBase<Key, Value>::yield;
   using BTreeBase<Key, Value>::makeRoot;
   using BTreeBase<Key, Value>::lookup;
+#if !defined(OMCS_RW)
   using BTreeBase<Key, Value>::scan;
+#endif
 
   BTreeOMCSLeaf() {
     std::cout << "========================================" << std::endl;
     std::cout << "BTree with OMCS on leaf nodes." << std::endl;
     std::cout << "Optimistic lock impl: " << OMCSLock::name << std::endl;
+    std::cout << "Backoff policy: " << backoff::name << std::endl;
     std::cout << "Page size (bytes): " << pageSize << std::endl;
     std::cout << "Max #entries: Leaf: " << BTreeLeaf<Key, Value>::maxEntries
               << ", Inner: " << BTreeInner<Key>::maxEntries << std::endl;
@@ -82,7 +89,31 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
     }
   };
 
+#if defined(OMCS_COMBINING)
+  // Latches [leaf], unless a holder of its latch applies [apply] to it on our
+  // behalf, which it only does if [valid]() still holds by then, i.e., if the
+  // traversal would not restart. Returns false in the latter case.
+  template <class Valid, class Apply>
+  static bool writeLockLeafOrCombine(NodeBase *leaf, OMCSLock::Context &q, Valid &&valid,
+                                     Apply &&apply) {
+    auto op = [&]() { return valid() && apply(static_cast<BTreeLeaf<Key, Value> *>(leaf)); };
+    return leaf->writeLockOrCombine(&q, op);
+  }
+#endif
+
   bool insertOptimistically(Key k, Value v) {
+#if defined(OMCS_COMBINING)
+    // Only inserts that do not split the leaf are combined
+    bool inserted = false;
+    auto insertIntoLeaf = [&](BTreeLeaf<Key, Value> *leaf) {
+      if (leaf->isFull()) {
+        return false;
+      }
+      inserted = leaf->insert(k, v);
+      return true;
+    };
+#endif
+
     int restartCount = 0;
   restart:
     if (restartCount++) yield(restartCount);
@@ -96,7 +127,13 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
       versionNode = node->readLockOrRestart(needRestart);
       if (needRestart) goto restart;
     } else {
+#if defined(OMCS_COMBINING)
+      if (!writeLockLeafOrCombine(node, q, [&]() { return node == root; }, insertIntoLeaf)) {
+        return inserted;
+      }
+#else
       node->writeLock(&q);
+#endif
     }
     read_nodes.Push(node, versionNode);
     if (node != root) {
@@ -127,7 +164,18 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
         }
       } else {
         // [next] is a leaf node
+#if defined(OMCS_COMBINING)
+        auto parentValid = [&]() {
+          bool parentRestart = false;
+          node->checkOrRestart(versionNode, parentRestart);
+          return !parentRestart;
+        };
+        if (!writeLockLeafOrCombine(next, q, parentValid, insertIntoLeaf)) {
+          return inserted;
+        }
+#else
         next->writeLock(&q);
+#endif
         auto next_leaf = static_cast<BTreeLeaf<Key, Value> *>(next);
         if (!next_leaf->isFull()) {
           release_ancestors = true;
@@ -316,7 +364,16 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
     }
   }
 
+#if defined(OMCS_COMBINING)
+  // [apply] is the caller's operation on the leaf. Returns false if a holder
+  // of the leaf's latch applied it on our behalf, in which case [node] is not
+  // latched.
+  template <class Apply>
+  bool traverseToLeafEx(Key k, OMCSLock::Context &q, NodeBase *&node, uint64_t &versionNode,
+                        Apply &&apply) {
+#else
   bool traverseToLeafEx(Key k, OMCSLock::Context &q, NodeBase *&node, uint64_t &versionNode) {
+#endif
     int restartCount = 0;
   restart:
     if (restartCount++) yield(restartCount);
@@ -326,7 +383,13 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
     node = root;
     if (node->getType() == PageType::BTreeLeaf) {
       // The root node is a leaf node.
+#if defined(OMCS_COMBINING)
+      if (!writeLockLeafOrCombine(node, q, [&]() { return node == root; }, apply)) {
+        return false;
+      }
+#else
       node->writeLock(&q);
+#endif
       if (node != root) {
         node->writeUnlock(&q);
         goto restart;
@@ -350,7 +413,18 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
         if (needRestart) goto restart;
       } else {
         // [next] is a leaf node, just take exclusive latch
+#if defined(OMCS_COMBINING)
+        auto parentValid = [&]() {
+          bool parentRestart = false;
+          node->checkOrRestart(versionNode, parentRestart);
+          return !parentRestart;
+        };
+        if (!writeLockLeafOrCombine(next, q, parentValid, apply)) {
+          return false;
+        }
+#else
         next->writeLock(&q);
+#endif
       }
       node->readUnlockOrRestart(versionNode, needRestart);
       if (needRestart) {
@@ -368,6 +442,86 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
     return true;
   }
 
+#if defined(OMCS_RW)
+  // Scans take shared latches on leaf nodes, coupled from left to right, so
+  // that a long scan does not restart when writers touch leaves it has
+  // already read. Inner nodes are still traversed optimistically, and point
+  // lookups stay optimistic. Writers latch one leaf at a time, so the
+  // coupling cannot deadlock.
+  uint64_t scan(Key k, int range, Value *output) {
+    int restartCount = 0;
+  restart:
+    if (restartCount++) yield(restartCount);
+    bool needRestart = false;
+
+    NodeBase *node = root;
+    if (node->getType() == PageType::BTreeLeaf) {
+      // The root node is a leaf node.
+      node->sharedLock();
+      if (node != root) {
+        node->sharedUnlock();
+        goto restart;
+      }
+    } else {
+      uint64_t versionNode = node->readLockOrRestart(needRestart);
+      if (needRestart || node != root) goto restart;
+
+      while (node->getType() == PageType::BTreeInner) {
+        auto inner = static_cast<BTreeInner<Key> *>(node);
+
+        NodeBase *next = inner->children[inner->lowerBound(k)];
+        node->checkOrRestart(versionNode, needRestart);
+        if (needRestart) goto restart;
+
+        uint64_t versionNext = OMCSLock::kInvalidVersion;
+        if (next->getType() == PageType::BTreeInner) {
+          // [next] is an inner node
+          versionNext = next->readLockOrRestart(needRestart);
+          if (needRestart) goto restart;
+        } else {
+          // [next] is a leaf node, just take shared latch
+          next->sharedLock();
+        }
+        node->readUnlockOrRestart(versionNode, needRestart);
+        if (needRestart) {
+          if (next->getType() == PageType::BTreeLeaf) {
+            next->sharedUnlock();
+          }
+          goto restart;
+        }
+
+        node = next;
+        versionNode = versionNext;
+      }
+    }
+
+    // We now have shared latch on [node]
+    auto leaf = static_cast<BTreeLeaf<Key, Value> *>(node);
+    unsigned pos = leaf->lowerBound(k);
+    int count = 0;
+
+    while (true) {
+      for (unsigned i = pos; i < leaf->count && count < range; i++) {
+        output[count++] = leaf->data[i].second;
+      }
+
+      auto next_leaf = leaf->next_leaf;
+      if (count == range || !next_leaf) {
+        // scan() finishes at [leaf]
+        leaf->sharedUnlock();
+        break;
+      }
+      // proceed with next leaf
+      next_leaf->sharedLock();
+      leaf->sharedUnlock();
+
+      leaf = next_leaf;
+      pos = 0;
+    }
+    return count;
+  }
+#endif
+
 #if defined(OMCS_OP_READ_NEW_API)
   bool traverseToLeafExNewAPI(Key k, OMCSLock::Context &q, NodeBase *&node, uint64_t &versionNode, bool &opread) {
     int restartCount = 0;
@@ -440,7 +594,21 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
     NodeBase *node = nullptr;
     uint64_t versionNode = OMCSLock::kInvalidVersion;
     DEFINE_CONTEXT(q, 0);
+#if defined(OMCS_COMBINING)
+    bool inserted = false;
+    auto insertIntoLeaf = [&](BTreeLeaf<Key, Value> *leaf) {
+      if (leaf->isFull()) {
+        return false;
+      }
+      inserted = leaf->insert(k, v);
+      return true;
+    };
+    if (!traverseToLeafEx(k, q, node, versionNode, insertIntoLeaf)) {
+      return inserted;
+    }
+#else
     traverseToLeafEx(k, q, node, versionNode);
+#endif
     auto leaf = static_cast<BTreeLeaf<Key, Value> *>(node);
     if (leaf->isFull()) {
       // We have bad luck. Unlock [node] and retry the entire traversal,
@@ -455,6 +623,25 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
 #endif
   }
 
+#if defined(OMCS_COMBINING)
+  // Removes and updates never change the shape of the tree, so a holder of the
+  // leaf's latch can always apply them on our behalf
+  bool remove(Key k) {
+    NodeBase *node = nullptr;
+    uint64_t versionNode = OMCSLock::kInvalidVersion;
+    DEFINE_CONTEXT(q, 0);
+    bool ok = false;
+    auto removeFromLeaf = [&](BTreeLeaf<Key, Value> *leaf) {
+      ok = leaf->remove(k);
+      return true;
+    };
+    if (traverseToLeafEx(k, q, node, versionNode, removeFromLeaf)) {
+      removeFromLeaf(static_cast<BTreeLeaf<Key, Value> *>(node));
+      node->writeUnlock(&q);
+    }
+    return ok;
+  }
+#else
   bool remove(Key k) {
     NodeBase *node = nullptr;
     uint64_t versionNode = OMCSLock::kInvalidVersion;
@@ -465,8 +652,25 @@ struct BTreeOMCSLeaf : public BTreeBase<Key, Value> {
     node->writeUnlock(&q);
     return ok;
   }
+#endif
 
-#if !defined(OMCS_OP_READ_NEW_API) && !defined(OMCS_OP_READ_NEW_API_CALLBACK)
+#if defined(OMCS_COMBINING)
+  bool update(Key k, Value v) {
+    NodeBase *node = nullptr;
+    uint64_t versionNode = OMCSLock::kInvalidVersion;
+    DEFINE_CONTEXT(q, 0);
+    bool ok = false;
+    auto updateInLeaf = [&](BTreeLeaf<Key, Value> *leaf) {
+      ok = leaf->update(k, v);
+      return true;
+    };
+    if (traverseToLeafEx(k, q, node, versionNode, updateInLeaf)) {
+      updateInLeaf(static_cast<BTreeLeaf<Key, Value> *>(node));
+      node->writeUnlock(&q);
+    }
+    return ok;
+  }
+#elif !defined(OMCS_OP_READ_NEW_API) && !defined(OMCS_OP_READ_NEW_API_CALLBACK)
   bool update(Key k, Value v) {
     NodeBase *node = nullptr;
     uint64_t versionNode = OMCSLock::kInvalidVersion;
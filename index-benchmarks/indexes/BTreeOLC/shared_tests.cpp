@@ -0,0 +1,90 @@
+// Multi-process test: fork()ed workers share one B+-tree, its OMCS locks and
+// queue nodes through the shared region (common/shared_region.h)
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "BTreeOMCSLeaf.h"
+#include "common/topology.h"
+
+using Tree = btreeolc::BTreeOMCSLeaf<uint64_t, uint64_t>;
+
+// Each process inserts and looks up its own slice of the keys, interleaved
+// with the other processes' slices
+int worker(Tree *tree, uint64_t n, int nprocs, int id) {
+  topology::pin(id);
+  offset::reset_tls_qnodes();
+  for (uint64_t k = id + 1; k <= n; k += nprocs) {
+    if (!tree->insert(k, __builtin_bswap64(k))) {
+      printf("[%d] key insertion failed: %lu\n", id, k);
+      return 1;
+    }
+  }
+  for (uint64_t k = id + 1; k <= n; k += nprocs) {
+    uint64_t val = 0;
+    if (!tree->lookup(k, val) || val != __builtin_bswap64(k)) {
+      printf("[%d] key not found: %lu\n", id, k);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    printf("usage: %s n <processes>\nn: number of keys\n", argv[0]);
+    return 1;
+  }
+  uint64_t n = std::atoll(argv[1]);
+  int nprocs = std::atoi(argv[2]);
+
+  // Room for the qnodes, and for nodes that are at least half full. Untouched
+  // pages of the region are never backed by memory.
+  shm::create((1ull << 30) + n * 4 * sizeof(uint64_t) * 2);
+  offset::init_qnodes();
+  Tree *tree = shm::make<Tree>();
+  shm::publish(shm::kIndex, tree);
+
+  topology::placement(topology::policy::kSmtLast);
+  printf("operation,n,processes,ops/s\n");
+  fflush(stdout);
+  auto starttime = std::chrono::system_clock::now();
+  for (int i = 0; i < nprocs; ++i) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      exit(worker(shm::lookup<Tree>(shm::kIndex), n, nprocs, i));
+    }
+  }
+  int failed = 0;
+  for (int i = 0; i < nprocs; ++i) {
+    int status;
+    wait(&status);
+    failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+  }
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now() - starttime);
+  printf("insert+lookup,%ld,%d,%f\n", n, nprocs, (2 * n * 1.0) / duration.count());
+  if (failed) {
+    printf("%d worker(s) failed\n", failed);
+    return 1;
+  }
+
+  // Everything the children inserted is visible to the parent
+  offset::reset_tls_qnodes();
+  for (uint64_t k = 1; k <= n; ++k) {
+    uint64_t val = 0;
+    if (!tree->lookup(k, val) || val != __builtin_bswap64(k)) {
+      printf("key not found: %lu\n", k);
+      return 1;
+    }
+  }
+  return 0;
+}
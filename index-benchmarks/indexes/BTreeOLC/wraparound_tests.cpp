@@ -0,0 +1,154 @@
+// Wraparound test: versions are narrowed to a few bits (OMCS_VERSION_BITS) so
+// that they wrap around all the time, and readers must still never validate a
+// snapshot across a wraparound (OMCS_WRAPAROUND_GUARD)
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "BTreeOMCSLeaf.h"
+#include "common/topology.h"
+
+using Lock = omcs_impl::OMCSLock;
+using Tree = btreeolc::BTreeOMCSLeaf<uint64_t, uint64_t>;
+
+static constexpr uint64_t kVersionsPerRound = Lock::kVersionMask / Lock::kVersionStride;
+
+#define CHECK_OR_FAIL(cond)                                     \
+  if (!(cond)) {                                                \
+    printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    return 1;                                                   \
+  }
+
+// The version comes back to the snapshot's after a full round of writers
+int single_lock(bool queued) {
+  Lock lock;
+  auto write = [&] {
+    if (queued) {
+      auto *q = offset::get_qnode(0);
+      lock.lock(q);
+      lock.unlock(q);
+    } else {
+      lock.lock();
+      lock.unlock();
+    }
+  };
+
+  // Version 0 is never used again
+  write();
+  for (int round = 0; round < 4; ++round) {
+    bool restart = false;
+    uint64_t snapshot = lock.try_begin_read(restart);
+    CHECK_OR_FAIL(!restart && lock.validate_read(snapshot));
+    for (uint64_t i = 0; i < kVersionsPerRound; ++i) {
+      write();
+    }
+    // Same version, but not the same snapshot
+    bool dummy;
+    CHECK_OR_FAIL((lock.load_version(dummy) & Lock::kVersionMask) ==
+                  ((snapshot ^ Lock::epoch_bits()) & Lock::kVersionMask));
+    CHECK_OR_FAIL(!lock.validate_read(snapshot));
+    CHECK_OR_FAIL(!lock.try_lock(snapshot));
+    // No carry out of the version when it wraps
+    CHECK_OR_FAIL((lock.load_version(dummy) & ~Lock::kVersionMask) == 0);
+
+    snapshot = lock.try_begin_read(restart);
+    CHECK_OR_FAIL(lock.try_lock(snapshot));
+    lock.unlock();
+  }
+  return 0;
+}
+
+// One writer keeps two words equal; readers must never validate a torn read
+int torn_reads(int nthreads, uint64_t iterations) {
+  Lock lock;
+  std::atomic<uint64_t> x{0}, y{0};
+  std::atomic<uint64_t> torn{0}, validated{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&, t] {
+      topology::pin(t);
+      offset::reset_tls_qnodes();
+      for (uint64_t i = 0; t == 0 ? i < iterations : !done.load(); ++i) {
+        if (t == 0) {
+          auto *q = offset::get_qnode(0);
+          lock.lock(q);
+          uint64_t v = x.load(std::memory_order_relaxed) + 1;
+          x.store(v, std::memory_order_relaxed);
+          std::this_thread::yield();
+          y.store(v, std::memory_order_relaxed);
+          lock.unlock(q);
+          done = i + 1 == iterations;
+        } else {
+          bool restart = false;
+          uint64_t snapshot = lock.try_begin_read(restart);
+          if (restart) {
+            continue;
+          }
+          uint64_t a = x.load(std::memory_order_relaxed);
+          std::this_thread::yield();
+          uint64_t b = y.load(std::memory_order_relaxed);
+          if (lock.validate_read(snapshot)) {
+            validated++;
+            torn += (a != b);
+          }
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  printf("torn reads: %lu of %lu validated\n", torn.load(), validated.load());
+  return torn.load() != 0;
+}
+
+int index(int nthreads, uint64_t n) {
+  Tree tree;
+  std::atomic<uint64_t> bad{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&, t] {
+      topology::pin(t);
+      offset::reset_tls_qnodes();
+      for (uint64_t k = t + 1; k <= n; k += nthreads) {
+        tree.insert(k, k);
+        uint64_t v = 0;
+        bad += !tree.lookup(k, v) || v != k;
+        tree.update(k, __builtin_bswap64(k));
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  offset::reset_tls_qnodes();
+  for (uint64_t k = 1; k <= n; ++k) {
+    uint64_t v = 0;
+    bad += !tree.lookup(k, v) || v != __builtin_bswap64(k);
+  }
+  printf("index: %lu bad lookups\n", bad.load());
+  return bad.load() != 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    printf("usage: %s n <threads>\nn: number of keys\n", argv[0]);
+    return 1;
+  }
+  uint64_t n = std::atoll(argv[1]);
+  int nthreads = std::atoi(argv[2]);
+  printf("%lu versions per round\n", kVersionsPerRound);
+
+  topology::placement(topology::policy::kSmtLast);
+  offset::init_qnodes();
+  offset::reset_tls_qnodes();
+  int failed = single_lock(false) + single_lock(true);
+  failed += torn_reads(nthreads, n);
+  failed += index(nthreads, n);
+  printf(failed ? "FAILED\n" : "OK\n");
+  return failed != 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <immintrin.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+#include <algorithm>
+
+#include "../common/random.h"
+
+// Contention management for spinning on centralized (optimistic) locks and
+// for restarting optimistic index operations. The policy is picked at compile
+// time with one of BACKOFF_EXPONENTIAL, BACKOFF_PROPORTIONAL and
+// BACKOFF_RANDOM; without any, callers retry right away as before.
+//
+// Callers report how many times in a row they failed (failed CASes on the lock
+// word, or restarts of an index operation). Centralized locks do not know
+// their queue depth, so this count also stands in for the number of threads
+// that got ahead of the caller.
+
+#if (defined(BACKOFF_EXPONENTIAL) + defined(BACKOFF_PROPORTIONAL) + defined(BACKOFF_RANDOM)) > 1
+#error "Only one backoff policy can be selected."
+#endif
+
+// Delay per unit of backoff
+#ifndef BACKOFF_UNIT_CYCLES
+#define BACKOFF_UNIT_CYCLES 64
+#endif
+
+// Upper bound of a single delay
+#ifndef BACKOFF_MAX_CYCLES
+#define BACKOFF_MAX_CYCLES 16384
+#endif
+
+namespace backoff {
+
+static constexpr uint64_t kUnitCycles = BACKOFF_UNIT_CYCLES;
+static constexpr uint64_t kMaxCycles = BACKOFF_MAX_CYCLES;
+static_assert(kUnitCycles > 0 && kUnitCycles <= kMaxCycles);
+
+inline void delay_cycles(uint64_t cycles) {
+  uint64_t start = __rdtsc();
+  while (__rdtsc() - start < cycles) {
+    _mm_pause();
+  }
+}
+
+// Unit delay doubled per failure, i.e., unit * 2^(failures - 1)
+inline uint64_t exponential_cycles(uint32_t failures) {
+  uint32_t shift = std::min<uint32_t>(failures ? failures - 1 : 0, 63);
+  if (shift >= 63 || (kMaxCycles >> shift) < kUnitCycles) {
+    return kMaxCycles;
+  }
+  return kUnitCycles << shift;
+}
+
+// Retry immediately
+struct NoBackoff {
+  static inline void pause(uint32_t failures) { (void)failures; }
+};
+
+// Bounded exponential backoff
+struct ExponentialBackoff {
+  static inline void pause(uint32_t failures) { delay_cycles(exponential_cycles(failures)); }
+};
+
+// Wait one unit per thread (estimated to be) ahead of us, after Anderson's
+// proportional backoff for ticket locks
+struct ProportionalBackoff {
+  static inline void pause(uint32_t failures) {
+    delay_cycles(std::min<uint64_t>(kUnitCycles * failures, kMaxCycles));
+  }
+};
+
+// Randomized exponential backoff: a uniform delay within the exponential
+// window, so that threads that failed together do not retry together
+struct RandomBackoff {
+  static inline void pause(uint32_t failures) {
+    uniform_random_generator rng;
+    uint64_t window = exponential_cycles(failures + 1);
+    delay_cycles(rng.next() % window);
+  }
+};
+
+#if defined(BACKOFF_EXPONENTIAL)
+using Policy = ExponentialBackoff;
+static constexpr const char *name = "exponential";
+#elif defined(BACKOFF_PROPORTIONAL)
+using Policy = ProportionalBackoff;
+static constexpr const char *name = "proportional";
+#elif defined(BACKOFF_RANDOM)
+using Policy = RandomBackoff;
+static constexpr const char *name = "random";
+#else
+using Policy = NoBackoff;
+static constexpr const char *name = "none";
+#endif
+
+// Backs off after the [failures]-th consecutive failure (counting from 1)
+inline void pause(uint32_t failures) { Policy::pause(failures); }
+
+}  // namespace backoff
@@ -0,0 +1,232 @@
+#pragma once
+
+/*
+ * Per-lock contention counters for the OMCS and MCS RW locks (LOCK_STATS).
+ *
+ * Each thread counts into its own table of cache-line-sized entries, keyed by
+ * lock address, so that counting never writes to memory shared with other
+ * threads. A lock that finds no free slot within a few probes of its hash is
+ * counted apart, in one of a few overflow entries picked by [overflow_group]
+ * (all in the first one if unset); per_lock() reports them under the null
+ * address and overflowed() per group. Tables outlive their threads;
+ * aggregate() sums up the locks that did fit per any grouping, e.g., per tree
+ * level:
+ *
+ *   auto levels = lock_stats::aggregate(
+ *       [](const void *lock) { return static_cast<const NodeBase *>(lock)->level; });
+ *
+ * aggregate(), overflowed() and reset() expect the locks to be quiescent.
+ * Without LOCK_STATS the LOCK_STATS_* macros used by the locks expand to
+ * nothing.
+ */
+#ifdef LOCK_STATS
+
+#include <x86intrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#ifndef CACHELINE_SIZE
+#define CACHELINE_SIZE 64
+#endif
+
+// Number of distinct locks each thread keeps separate counts for; power of two
+#ifndef LOCK_STATS_SLOTS
+#define LOCK_STATS_SLOTS 4096
+#endif
+
+// Slots a lock may probe before it is counted as overflowed
+#ifndef LOCK_STATS_MAX_PROBES
+#define LOCK_STATS_MAX_PROBES 16
+#endif
+
+// Number of overflow entries per thread
+#ifndef LOCK_STATS_OVERFLOW_GROUPS
+#define LOCK_STATS_OVERFLOW_GROUPS 16
+#endif
+
+namespace lock_stats {
+
+enum counter : uint32_t {
+  kAcquisitions,     // Exclusive or shared acquisitions
+  kQueued,           // Acquisitions that found the lock held or a predecessor queued
+  kWaitCycles,       // TSC cycles spent waiting in those acquisitions
+  kValidateFailures, // Failed optimistic read validations
+  kOpReadSuccesses,  // Successful validations of reads done under opread
+  kNumCounters
+};
+
+inline constexpr const char *kCounterNames[kNumCounters] = {
+    "acquisitions", "queued", "wait_cycles", "validate_failures", "opread_successes"};
+
+struct counts {
+  uint64_t values[kNumCounters] = {};
+
+  uint64_t &operator[](counter c) { return values[c]; }
+  uint64_t operator[](counter c) const { return values[c]; }
+
+  bool any() const {
+    for (uint64_t v : values) {
+      if (v) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  counts &operator+=(const counts &other) {
+    for (uint32_t i = 0; i < kNumCounters; ++i) {
+      values[i] += other.values[i];
+    }
+    return *this;
+  }
+};
+
+struct alignas(CACHELINE_SIZE) entry {
+  const void *lock;
+  counts stats;
+};
+
+// Maps a lock to its overflow entry (modulo LOCK_STATS_OVERFLOW_GROUPS), e.g.,
+// the level of the tree node it protects. Set it before any lock is counted.
+inline uint32_t (*overflow_group)(const void *lock) = nullptr;
+
+struct thread_table {
+  static constexpr uint64_t kSlots = LOCK_STATS_SLOTS;
+  static constexpr uint64_t kMaxProbes = LOCK_STATS_MAX_PROBES;
+  static constexpr uint32_t kOverflowGroups = LOCK_STATS_OVERFLOW_GROUPS;
+  static_assert((kSlots & (kSlots - 1)) == 0, "LOCK_STATS_SLOTS must be a power of two");
+  static_assert(kSlots <= (1ull << 32), "LOCK_STATS_SLOTS must fit the hash");
+
+  entry entries[kSlots];
+  entry overflow[kOverflowGroups];
+
+  entry &find(const void *lock) {
+    // Locks are page aligned in most indexes, so take the high bits of the
+    // product rather than the (mostly zero) low ones
+    uint64_t h = reinterpret_cast<uintptr_t>(lock) * 0x9E3779B97F4A7C15ull >> 32;
+    for (uint64_t i = 0; i < std::min(kMaxProbes, kSlots); ++i) {
+      entry &e = entries[(h + i) & (kSlots - 1)];
+      if (e.lock == lock) {
+        return e;
+      }
+      if (e.lock == nullptr) {
+        e.lock = lock;
+        return e;
+      }
+    }
+    return overflow[overflow_group ? overflow_group(lock) % kOverflowGroups : 0];
+  }
+};
+
+// Tables of all threads that ever counted, never freed
+inline std::mutex tables_mutex;
+inline std::vector<thread_table *> tables;
+
+inline thread_table &local_table() {
+  static thread_local thread_table *table = [] {
+    auto *t = new thread_table();
+    std::lock_guard<std::mutex> guard(tables_mutex);
+    tables.push_back(t);
+    return t;
+  }();
+  return *table;
+}
+
+inline void add(const void *lock, counter c) { ++local_table().find(lock).stats[c]; }
+
+// Counts an acquisition that started at [wait_start] and had to wait if
+// [contended]
+inline void acquired(const void *lock, uint64_t wait_start, bool contended) {
+  counts &stats = local_table().find(lock).stats;
+  ++stats[kAcquisitions];
+  if (contended) {
+    ++stats[kQueued];
+    stats[kWaitCycles] += __rdtsc() - wait_start;
+  }
+}
+
+// Sums up the counts of the locks for which [group_of] returns the same key
+template <class GroupOf>
+inline auto aggregate(GroupOf &&group_of) {
+  using Key = std::decay_t<decltype(group_of(std::declval<const void *>()))>;
+  std::map<Key, counts> result;
+  std::lock_guard<std::mutex> guard(tables_mutex);
+  for (thread_table *t : tables) {
+    for (const entry &e : t->entries) {
+      if (e.lock) {
+        result[group_of(e.lock)] += e.stats;
+      }
+    }
+  }
+  return result;
+}
+
+// Counts of the locks that overflowed the threads' tables, per overflow group
+inline std::map<uint32_t, counts> overflowed() {
+  std::map<uint32_t, counts> result;
+  std::lock_guard<std::mutex> guard(tables_mutex);
+  for (thread_table *t : tables) {
+    for (uint32_t g = 0; g < thread_table::kOverflowGroups; ++g) {
+      if (t->overflow[g].stats.any()) {
+        result[g] += t->overflow[g].stats;
+      }
+    }
+  }
+  return result;
+}
+
+// Counts per lock address; null collects what overflowed the threads' tables
+inline std::map<const void *, counts> per_lock() {
+  auto result = aggregate([](const void *lock) { return lock; });
+  for (const auto &[group, stats] : overflowed()) {
+    result[nullptr] += stats;
+  }
+  return result;
+}
+
+// One CSV line per group, e.g., for the output of aggregate()
+template <class Key>
+inline void print(const std::map<Key, counts> &result, const char *key_name,
+                  std::ostream &os = std::cout) {
+  os << key_name;
+  for (const char *name : kCounterNames) {
+    os << "," << name;
+  }
+  os << std::endl;
+  for (const auto &[key, stats] : result) {
+    os << +key;
+    for (uint64_t v : stats.values) {
+      os << "," << v;
+    }
+    os << std::endl;
+  }
+}
+
+inline void reset() {
+  std::lock_guard<std::mutex> guard(tables_mutex);
+  for (thread_table *t : tables) {
+    memset(static_cast<void *>(t), 0, sizeof(thread_table));
+  }
+}
+
+}  // namespace lock_stats
+
+#define LOCK_STATS_INC(lock, c) lock_stats::add(lock, lock_stats::c)
+#define LOCK_STATS_WAIT_BEGIN(t) uint64_t t = __rdtsc()
+#define LOCK_STATS_ACQUIRED(lock, t, contended) lock_stats::acquired(lock, t, contended)
+
+#else
+
+#define LOCK_STATS_INC(lock, c)
+#define LOCK_STATS_WAIT_BEGIN(t)
+#define LOCK_STATS_ACQUIRED(lock, t, contended)
+
+#endif  // LOCK_STATS
@@ -15,10 +15,18 @@ namespace mcs {
 
 class MCSLock;
 
+// See omcs_impl::OMCSQNode for the COMPACT_QNODE layout
+#ifdef COMPACT_QNODE
+struct alignas(CACHELINE_SIZE) MCSQNode {
+ public:
+  std::atomic<MCSQNode *> next_;
+  std::atomic<uint64_t> granted_;
+#else
 struct alignas(CACHELINE_SIZE * 2) MCSQNode {
  public:
   alignas(CACHELINE_SIZE * 2) std::atomic<MCSQNode *> next_;
   alignas(CACHELINE_SIZE * 2) std::atomic<uint64_t> granted_;
+#endif
 
 #ifndef NDEBUG
   MCSLock *lock_;
@@ -36,6 +44,10 @@ struct alignas(CACHELINE_SIZE * 2) MCSQNode {
   inline const uint64_t get_granted() const { return granted_.load(std::memory_order_acquire); }
 };
 
+#ifdef COMPACT_QNODE
+static_assert(sizeof(MCSQNode) == CACHELINE_SIZE, "MCSQNode does not fit in a cache line");
+#endif
+
 class MCSLock {
  public:
   static constexpr uint64_t kNullPtr = 0;
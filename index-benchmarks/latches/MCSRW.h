@@ -3,10 +3,14 @@
 #include <glog/logging.h>
 #include <immintrin.h>
 #include <stdint.h>
+#include <x86intrin.h>
 
 #include <atomic>
 #include <cassert>
 
+#include "LockStats.h"
+#include "OMCSLayout.h"
+
 namespace mcsrw {
 
 // Implementation follows https://www.cs.rochester.edu/research/synchronization/pseudocode/rw.html
@@ -23,6 +27,10 @@ namespace mcsrw {
 static_assert(false, "Centralized rwlock has no implementation");
 #endif
 
+#if defined(MCSRW_BRAVO) && defined(OPT_MCSRW_HYBRID_LOCK)
+static_assert(false, "MCSRW_BRAVO is not supported by the OptLock + MCS RW Lock hybrid");
+#endif
+
 #ifdef OMCS_OFFSET
 using offset_t = uint16_t;
 #else
@@ -34,11 +42,21 @@ class MCSRWLock;
 enum class MCSRWRequestorClass : uint64_t { READING, WRITING };
 enum class MCSRWSuccessorClass : uint32_t { NONE, READER, WRITER };
 
+// With COMPACT_QNODE all fields share one cache line, see
+// omcs_impl::OMCSQNode. [state_] is what waiters spin on.
+#ifdef COMPACT_QNODE
+struct alignas(CACHELINE_SIZE) MCSRWQNode {
+ public:
+  std::atomic<MCSRWQNode *> next_;
+  std::atomic<MCSRWRequestorClass> class_;
+  union MCSRWQNodeState {
+#else
 struct alignas(CACHELINE_SIZE * 2) MCSRWQNode {
  public:
   alignas(CACHELINE_SIZE) std::atomic<MCSRWQNode *> next_;
   alignas(CACHELINE_SIZE) std::atomic<MCSRWRequestorClass> class_;
   alignas(CACHELINE_SIZE * 2) union MCSRWQNodeState {
+#endif
     std::atomic<uint64_t> state_;
     struct MCSRWQNodeStateBlockAndSuccessorClass {
       std::atomic<uint32_t> blocked_;
@@ -101,22 +119,87 @@ struct alignas(CACHELINE_SIZE * 2) MCSRWQNode {
   }
 };
 
+#ifdef COMPACT_QNODE
+static_assert(sizeof(MCSRWQNode) == CACHELINE_SIZE, "MCSRWQNode does not fit in a cache line");
+#endif
+
 #ifdef OMCS_OFFSET
 extern MCSRWQNode *base_qnode;
 #endif
 
+#ifdef MCSRW_BRAVO
+/*
+ * BRAVO-style reader bias (Dice and Kogan, "BRAVO -- Biased Locking for
+ * Reader-Writer Locks", ATC'19) on top of MCSRWLock.
+ *
+ * While a lock is reader-biased, readers skip the shared reader count and
+ * publish the lock's address in a slot of the global visible readers table
+ * instead. Every thread owns MCSRW_BRAVO_SLOTS_PER_THREAD slots (one cache
+ * line by default) and picks one by hashing the lock, so readers on different
+ * threads never write to the same cache line, and a slot holding the lock
+ * always belongs to the calling thread. Readers fall back to the underlying
+ * lock if the slot is taken, or if the thread has no slots (more than
+ * MCSRW_BRAVO_MAX_THREADS threads).
+ *
+ * A writer that acquires a reader-biased lock revokes the bias and waits until
+ * no slot holds the lock. Revocation scans the whole table, so the bias is
+ * only re-enabled by readers on the slow path after MCSRW_BRAVO_INHIBIT_MULTIPLIER
+ * times the duration of the last revocation.
+ */
+#ifndef MCSRW_BRAVO_MAX_THREADS
+#define MCSRW_BRAVO_MAX_THREADS 512
+#endif
+
+#ifndef MCSRW_BRAVO_SLOTS_PER_THREAD
+#define MCSRW_BRAVO_SLOTS_PER_THREAD (CACHELINE_SIZE / sizeof(void *))
+#endif
+
+#ifndef MCSRW_BRAVO_INHIBIT_MULTIPLIER
+#define MCSRW_BRAVO_INHIBIT_MULTIPLIER 9
+#endif
+
+namespace bravo {
+
+static constexpr uint32_t kMaxThreads = MCSRW_BRAVO_MAX_THREADS;
+static constexpr uint32_t kSlotsPerThread = MCSRW_BRAVO_SLOTS_PER_THREAD;
+static constexpr uint32_t kNumSlots = kMaxThreads * kSlotsPerThread;
+static constexpr uint64_t kInhibitMultiplier = MCSRW_BRAVO_INHIBIT_MULTIPLIER;
+static_assert(kSlotsPerThread > 0 && kNumSlots / kSlotsPerThread == kMaxThreads);
+
+alignas(CACHELINE_SIZE) inline std::atomic<const void *> visible_readers[kNumSlots];
+inline std::atomic<uint32_t> next_thread_id{0};
+
+// Slot of the calling thread for [lock], or nullptr if the thread has none
+inline std::atomic<const void *> *reader_slot(const void *lock) {
+  thread_local uint32_t thread_id = next_thread_id.fetch_add(1);
+  if (thread_id >= kMaxThreads) {
+    return nullptr;
+  }
+  uint64_t h = reinterpret_cast<uintptr_t>(lock) * 0x9e3779b97f4a7c15ull;
+  return &visible_readers[thread_id * kSlotsPerThread + (h >> 32) % kSlotsPerThread];
+}
+
+// Waits until no reader has [lock] published
+inline void wait_for_readers(const void *lock) {
+  for (uint32_t i = 0; i < kNumSlots; ++i) {
+    while (visible_readers[i].load(std::memory_order_acquire) == lock) {
+      _mm_pause();
+    }
+  }
+}
+
+}  // namespace bravo
+#endif  // MCSRW_BRAVO
+
 class MCSRWLock {
  public:
   static constexpr uint32_t kFree = 0;
   static constexpr uint32_t kWriterActiveFlag = 0x1;
   static constexpr uint32_t kReaderCountIncr = 0x10;
 #ifdef OMCS_OFFSET
-#ifdef BTREE_RWLOCK_MCSRW_ONLY
-  static constexpr uint64_t kQueueNodeIdBits = 12;  // At most 4096 qnodes
-#else
-  static constexpr uint64_t kQueueNodeIdBits = 10;  // At most 1024 qnodes
-#endif
-  static constexpr uint64_t kNumQueueNodes = 1 << kQueueNodeIdBits;
+  // Same number of qnodes as OMCSLock; the version bits are not used
+  static constexpr uint64_t kQueueNodeIdBits = omcs_impl::OMCSDefaultLayout::kQueueNodeIdBits;
+  static constexpr uint64_t kNumQueueNodes = omcs_impl::OMCSDefaultLayout::kNumQueueNodes;
   static_assert(kQueueNodeIdBits + 1 <= 16);
 #endif  // OMCS_OFFSET
 
@@ -176,6 +259,70 @@ class MCSRWLock {
 #define reader_count_and_flag_ u32_
 #endif
 
+#ifdef MCSRW_BRAVO
+  // |-63-|------62-0------|
+  // |bias|inhibit until   |
+  //
+  // where "inhibit until" is the TSC before which the bias stays off
+  static constexpr uint64_t kReaderBias = 1ull << 63;
+
+  std::atomic<uint64_t> bias_{0};
+
+  // Reader fast path: true if the reader got in through its visible readers
+  // slot, in which case it must not touch the underlying lock
+  inline bool bravo_read_lock() {
+    if (!(bias_.load(std::memory_order_acquire) & kReaderBias)) {
+      return false;
+    }
+    std::atomic<const void *> *slot = bravo::reader_slot(this);
+    if (slot == nullptr) {
+      return false;
+    }
+    const void *expected = nullptr;
+    if (!slot->compare_exchange_strong(expected, this)) {
+      return false;
+    }
+    // Pairs with the revocation in bravo_revoke(): either we see the bias
+    // cleared, or the writer sees our slot
+    if (bias_.load() & kReaderBias) {
+      return true;
+    }
+    slot->store(nullptr, std::memory_order_release);
+    return false;
+  }
+
+  inline bool bravo_read_unlock() {
+    std::atomic<const void *> *slot = bravo::reader_slot(this);
+    if (slot == nullptr || slot->load(std::memory_order_relaxed) != this) {
+      return false;
+    }
+    slot->store(nullptr, std::memory_order_release);
+    return true;
+  }
+
+  // Called by readers holding the underlying lock: writers are excluded, so
+  // the bias cannot be revoked under our feet
+  inline void bravo_enable() {
+    uint64_t b = bias_.load(std::memory_order_relaxed);
+    if (!(b & kReaderBias) && __rdtsc() >= b) {
+      bias_.store(kReaderBias, std::memory_order_relaxed);
+    }
+  }
+
+  // Called by writers right after acquiring the underlying lock
+  inline void bravo_revoke() {
+    if (!(bias_.load() & kReaderBias)) {
+      return;
+    }
+    uint64_t start = __rdtsc();
+    bias_.store(0);
+    bravo::wait_for_readers(this);
+    uint64_t now = __rdtsc();
+    bias_.store((now + (now - start) * bravo::kInhibitMultiplier) & ~kReaderBias,
+                std::memory_order_release);
+  }
+#endif  // MCSRW_BRAVO
+
  public:
   MCSRWLock() = default;
 
@@ -183,22 +330,35 @@ class MCSRWLock {
   MCSRWLock &operator=(const MCSRWLock &) = delete;
 
   inline void lock() {
+    [[maybe_unused]] bool held = false;
+    LOCK_STATS_WAIT_BEGIN(wait_start);
 #if defined(RWLOCK_WRITER_PREFERENCE)
     auto prev_writer = write_requests_.fetch_add(1);
     while (write_completions_.load(std::memory_order_acquire) != prev_writer) {
+      held = true;
     }
     while (true) {
       auto expected = kFree;
       if (reader_count_and_flag_.compare_exchange_strong(expected, kWriterActiveFlag)) {
+        LOCK_STATS_ACQUIRED(this, wait_start, held);
+#ifdef MCSRW_BRAVO
+        bravo_revoke();
+#endif
         return;
       }
+      held = true;
     }
 #elif defined(RWLOCK_READER_PREFERENCE)
     while (true) {
       auto expected = kFree;
       if (reader_count_and_flag_.compare_exchange_strong(expected, kWriterActiveFlag)) {
+        LOCK_STATS_ACQUIRED(this, wait_start, held);
+#ifdef MCSRW_BRAVO
+        bravo_revoke();
+#endif
         return;
       }
+      held = true;
     }
 #else
     LOG(FATAL) << "Not implemented";
@@ -217,6 +377,14 @@ class MCSRWLock {
   }
 
   inline void read_lock() {
+#ifdef MCSRW_BRAVO
+    if (bravo_read_lock()) {
+      LOCK_STATS_INC(this, kAcquisitions);
+      return;
+    }
+#endif
+    [[maybe_unused]] bool held = false;
+    LOCK_STATS_WAIT_BEGIN(wait_start);
 #if defined(RWLOCK_WRITER_PREFERENCE)
     while (true) {
       auto requested_writer = write_requests_.load(std::memory_order_acquire);
@@ -224,20 +392,32 @@ class MCSRWLock {
       if (requested_writer == finished_writer) {
         break;
       }
+      held = true;
     }
     reader_count_and_flag_.fetch_add(kReaderCountIncr);
     while (reader_count_and_flag_.load(std::memory_order_acquire) & kWriterActiveFlag) {
+      held = true;
     }
 #elif defined(RWLOCK_READER_PREFERENCE)
     reader_count_and_flag_.fetch_add(kReaderCountIncr);
     while (reader_count_and_flag_.load(std::memory_order_acquire) & kWriterActiveFlag) {
+      held = true;
     }
 #else
     LOG(FATAL) << "Not implemented";
+#endif
+    LOCK_STATS_ACQUIRED(this, wait_start, held);
+#ifdef MCSRW_BRAVO
+    bravo_enable();
 #endif
   }
 
   inline void read_unlock() {
+#ifdef MCSRW_BRAVO
+    if (bravo_read_unlock()) {
+      return;
+    }
+#endif
 #if defined(RWLOCK_WRITER_PREFERENCE)
     reader_count_and_flag_.fetch_sub(kReaderCountIncr);
 #elif defined(RWLOCK_READER_PREFERENCE)
@@ -272,6 +452,10 @@ class MCSRWLock {
       if (reader_count_.load(std::memory_order_acquire) == 0) {
         if (next_writer_.exchange(kNullPtr) == self) {
           qnode->set_blocked(kUnblocked);
+          LOCK_STATS_INC(this, kAcquisitions);
+#ifdef MCSRW_BRAVO
+          bravo_revoke();
+#endif
           return;
         }
       }
@@ -282,8 +466,14 @@ class MCSRWLock {
       pred->set_next(qnode);
     }
 
+    // Behind a predecessor or shared readers
+    LOCK_STATS_WAIT_BEGIN(wait_start);
     while (qnode->get_blocked() == kBlocked) {
     }
+    LOCK_STATS_ACQUIRED(this, wait_start, true);
+#ifdef MCSRW_BRAVO
+    bravo_revoke();
+#endif
   }
 
   inline void unlock(MCSRWQNode *qnode) {
@@ -320,6 +510,13 @@ class MCSRWLock {
     qnode->set_lock(this);
 #endif
 
+#ifdef MCSRW_BRAVO
+    if (bravo_read_lock()) {
+      LOCK_STATS_INC(this, kAcquisitions);
+      return;
+    }
+#endif
+
     qnode->set_class(MCSRWRequestorClass::READING);
     qnode->set_state(kBlocked, MCSRWSuccessorClass::NONE);
     qnode->set_next(nullptr);
@@ -329,6 +526,7 @@ class MCSRWLock {
     if (prev == kNullPtr) {
       reader_count_.fetch_add(1);
       qnode->set_blocked(kUnblocked);
+      LOCK_STATS_INC(this, kAcquisitions);
     } else {
       MCSRWQNode *pred = MCSRWLock::get_qnode_ptr(prev);
       if (pred->get_class() == MCSRWRequestorClass::WRITING ||
@@ -336,12 +534,16 @@ class MCSRWLock {
               MCSRWQNode::make_state(kBlocked, MCSRWSuccessorClass::NONE),
               MCSRWQNode::make_state(kBlocked, MCSRWSuccessorClass::READER))) {
         pred->set_next(qnode);
+        LOCK_STATS_WAIT_BEGIN(wait_start);
         while (qnode->get_blocked() == kBlocked) {
         }
+        LOCK_STATS_ACQUIRED(this, wait_start, true);
       } else {
+        // Joins the active readers of its predecessor
         reader_count_.fetch_add(1);
         pred->set_next(qnode);
         qnode->set_blocked(kUnblocked);
+        LOCK_STATS_INC(this, kAcquisitions);
       }
     }
 
@@ -356,6 +558,9 @@ class MCSRWLock {
       reader_count_.fetch_add(1);
       succ->set_blocked(kUnblocked);
     }
+#ifdef MCSRW_BRAVO
+    bravo_enable();
+#endif
   }
 
   inline void read_unlock(MCSRWQNode *qnode) {
@@ -365,6 +570,12 @@ class MCSRWLock {
     qnode->assert_lock(this);
 #endif
 
+#ifdef MCSRW_BRAVO
+    if (bravo_read_unlock()) {
+      return;
+    }
+#endif
+
     MCSRWQNode *succ = qnode->get_next();
     if (succ == nullptr) {
       offset_t self = MCSRWLock::make_qnode_ptr(qnode);
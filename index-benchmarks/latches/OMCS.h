@@ -3,7 +3,15 @@
 #include <atomic>
 #include <cstdint>
 
-#if defined(OMCS_LOCK)
+#if defined(OMCS_COHORT) && defined(OMCS_RW)
+#error "OMCS_COHORT and OMCS_RW are mutually exclusive."
+#endif
+
+#if defined(OMCS_LOCK) && defined(OMCS_COHORT)
+#include "OMCSCohort.h"
+#elif defined(OMCS_LOCK) && defined(OMCS_RW)
+#include "OMCSRW.h"
+#elif defined(OMCS_LOCK)
 #include "OMCSImpl.h"
 #elif defined(STDRW_LOCK)
 #include "STDRW.h"
@@ -15,7 +23,17 @@
 #endif
 
 struct OMCSLock {
-#if defined(OMCS_LOCK)
+#if defined(OMCS_LOCK) && defined(OMCS_COHORT)
+  using Lock = omcs_impl::OMCSCohortLock;
+  using Context = omcs_impl::OMCSQNode;
+  static constexpr uint64_t kInvalidVersion = omcs_impl::OMCSCohortLock::kInvalidVersion;
+  static constexpr const char *name = "OMCS Cohort Lock";
+#elif defined(OMCS_LOCK) && defined(OMCS_RW)
+  using Lock = omcs_impl::OMCSRWLock;
+  using Context = omcs_impl::OMCSQNode;
+  static constexpr uint64_t kInvalidVersion = omcs_impl::OMCSRWLock::kInvalidVersion;
+  static constexpr const char *name = "OMCS RW Lock";
+#elif defined(OMCS_LOCK)
   using Lock = omcs_impl::OMCSLock;
   using Context = omcs_impl::OMCSQNode;
   static constexpr uint64_t kInvalidVersion = omcs_impl::OMCSLock::kInvalidVersion;
@@ -27,7 +45,11 @@ struct OMCSLock {
 #elif defined(MCSRW_LOCK)
   using Lock = mcsrw::MCSRWLock;
   using Context = mcsrw::MCSRWQNode;
+#if defined(MCSRW_BRAVO)
+  static constexpr const char *name = "MCS RW Lock (BRAVO)";
+#else
   static constexpr const char *name = "MCS RW Lock";
+#endif
 #elif defined(OPT_MCSRW_HYBRID_LOCK)
   using Lock = uint64_t;
   using Context = mcsrw::MCSRWQNode;
@@ -65,6 +87,39 @@ struct OMCSLock {
 
   void writeLock(Context *q) { lock.lock(q); }
 
+#if defined(OMCS_ABORTABLE)
+  // Gives up after [timeoutCycles]; see omcs_impl::BasicOMCSLock::try_lock_for
+  bool writeLockFor(Context *q, uint64_t timeoutCycles) { return lock.try_lock_for(q, timeoutCycles); }
+#endif
+
+#if defined(OMCS_COMBINING)
+  // Returns false if a lock holder ran [op]() on our behalf instead of
+  // granting us the lock; see omcs_impl::BasicOMCSLock::lock_or_combine
+  template <class Op>
+  bool writeLockOrCombine(Context *q, Op &op) {
+    return lock.lock_or_combine(
+        q, [](void *arg) { return (*static_cast<Op *>(arg))(); }, &op);
+  }
+#endif
+
+#if defined(OMCS_OBSOLETE_BIT)
+  // Obsolete flag in the lock word; see omcs_impl::OMCSLayout
+  static bool isObsolete(uint64_t version) { return Lock::is_obsolete(version); }
+
+  static bool isObsolete(const Context *q) { return Lock::is_obsolete(q); }
+
+  void writeUnlockObsolete() { lock.unlock_obsolete(); }
+
+  void writeUnlockObsolete(Context *q) { lock.unlock_obsolete(q); }
+#endif
+
+#if defined(OMCS_RW)
+  // Pessimistic shared mode; see omcs_impl::BasicOMCSRWLock
+  void sharedLock() { lock.read_lock(); }
+
+  void sharedUnlock() { lock.read_unlock(); }
+#endif
+
 #if defined(OMCS_OP_READ_NEW_API_CALLBACK)
   template <class Callback>
   void writeLockWithRead(Context *q, Callback &&cb) {
@@ -161,12 +216,23 @@ struct MCSRWLock {
 };
 #endif
 
-#if defined(OMCS_LOCK)
+#if defined(OMCS_LOCK) && defined(OMCS_COHORT) && defined(OMCS_COHORT_PADDED)
+// 8-byte lock word, a cache line apart from the per-socket local queue tails
+static_assert(sizeof(OMCSLock) == CACHELINE_SIZE + 8 * omcs_impl::OMCSCohortLock::kMaxSockets,
+              "sizeof OMCSLock is not a cache line + local tails");
+#elif defined(OMCS_LOCK) && defined(OMCS_COHORT)
+// 8-byte lock word followed by the per-socket local queue tails
+static_assert(sizeof(OMCSLock) == 8 * (1 + omcs_impl::OMCSCohortLock::kMaxSockets),
+              "sizeof OMCSLock is not 8-byte + local tails");
+#elif defined(OMCS_LOCK)
 static_assert(sizeof(OMCSLock) == 8, "sizeof OMCSLock is not 8-byte");
 #elif defined(STDRW_LOCK)
 static_assert(sizeof(OMCSLock) == 56, "sizeof OMCSLock is not 56-byte");
 #elif defined(MCSRW_LOCK)
-#if defined(OMCS_OFFSET)
+#if defined(OMCS_OFFSET) && defined(MCSRW_BRAVO)
+// 8-byte lock followed by the reader bias word
+static_assert(sizeof(OMCSLock) == 16, "sizeof OMCSLock is not 16-byte");
+#elif defined(OMCS_OFFSET)
 static_assert(sizeof(OMCSLock) == 8, "sizeof OMCSLock is not 8-byte");
 #endif
 #elif defined(OPT_MCSRW_HYBRID_LOCK)
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <type_traits>
+
+#include "../common/topology.h"
+#include "OMCSImpl.h"
+
+namespace omcs_impl {
+
+#if defined(OMCS_OP_READ)
+static_assert(false, "OMCS_OP_READ is not supported by the cohort OMCS lock");
+#endif
+#if defined(OMCS_ABORTABLE)
+static_assert(false, "OMCS_ABORTABLE is not supported by the cohort OMCS lock");
+#endif
+#if defined(OMCS_COMBINING)
+static_assert(false, "OMCS_COMBINING is not supported by the cohort OMCS lock");
+#endif
+#if defined(OMCS_OBSOLETE_BIT)
+static_assert(false, "OMCS_OBSOLETE_BIT is not supported by the cohort OMCS lock");
+#endif
+#if defined(OMCS_WRAPAROUND_GUARD)
+static_assert(false, "OMCS_WRAPAROUND_GUARD is not supported by the cohort OMCS lock");
+#endif
+
+// Number of per-socket local queues in each lock; threads on sockets beyond
+// this share queues (socket % OMCS_COHORT_MAX_SOCKETS).
+#ifndef OMCS_COHORT_MAX_SOCKETS
+#define OMCS_COHORT_MAX_SOCKETS 4
+#endif
+
+// Fairness bound: the maximum number of consecutive lock holders from one
+// socket before the global lock must be released to the other sockets.
+#ifndef OMCS_COHORT_MAX_LOCAL_HANDOFFS
+#define OMCS_COHORT_MAX_LOCAL_HANDOFFS 64
+#endif
+
+// Local queue of the calling thread
+inline uint32_t cohort_socket() { return topology::current_node() % OMCS_COHORT_MAX_SOCKETS; }
+
+/*
+ * Cohort (hierarchical) variant of the OMCS lock, after the C-BO-MCS lock of
+ * Dice et al. ("Lock Cohorting", PPoPP'12).
+ *
+ * The lock word is a centralized optimistic lock, exactly like the one
+ * BasicOMCSLock uses without queue nodes:
+ *
+ * |-63-|--------62-0--------|
+ * |lock|---version number---|
+ *
+ * so optimistic readers (try_begin_read/validate_read) and the qnode-less
+ * lock/try_lock/unlock API work unchanged. Queue-based writers first line up
+ * in an MCS queue of their own socket, and only the head of each local queue
+ * competes for the lock word. When releasing, a holder with a local successor
+ * passes the lock word along without touching it, so under contention the
+ * lock stays on one socket for up to OMCS_COHORT_MAX_LOCAL_HANDOFFS holders
+ * before it is released for the other sockets to take it.
+ *
+ * A reader's snapshot is still invalidated by every batch of holders: the
+ * version is bumped once when the lock word is released, and the lock bit is
+ * set in between.
+ *
+ * The queue nodes carry raw pointers in the local tails, so both stack and
+ * pooled (OMCS_OFFSET) queue nodes work. A holder's queue node records which
+ * local queue it came from and how many local handoffs preceded it, as
+ *
+ * |---63-8---|----7-0----|
+ * |-handoffs-|queue + 1  |
+ *
+ * in its [version_]. Queue 0 means the lock word was taken without queueing;
+ * zero handoffs (for a waiter) means the predecessor released the lock word
+ * and the waiter has to acquire it itself.
+ *
+ * The local tails follow the lock word, so the lock takes
+ * 8 * (1 + OMCS_COHORT_MAX_SOCKETS) bytes, and every writer's exchange on a
+ * tail invalidates the readers' copy of the lock word. OMCS_COHORT_PADDED puts
+ * a cache line's worth of padding between them instead, at the cost of
+ * CACHELINE_SIZE more bytes in every index node.
+ */
+template <class Layout>
+class BasicOMCSCohortLock {
+ public:
+#ifdef OMCS_OFFSET
+  // Queue nodes are not encoded in the lock word, but the queue node pools are
+  // sized by the layout
+  static constexpr uint64_t kQueueNodeIdBits = Layout::kQueueNodeIdBits;
+  static constexpr uint64_t kNumQueueNodes = Layout::kNumQueueNodes;
+#endif
+
+  static constexpr uint64_t kLockedBit = 1ull << 63;
+  static constexpr uint64_t kInvalidVersion = OMCSQNode::kNoGrant;
+  static constexpr uint64_t kVersionStride = 1;
+
+  static constexpr uint32_t kMaxSockets = OMCS_COHORT_MAX_SOCKETS;
+  static constexpr uint64_t kMaxLocalHandoffs = OMCS_COHORT_MAX_LOCAL_HANDOFFS;
+  static_assert(kMaxSockets > 0 && kMaxSockets < 255);
+  static_assert(kMaxLocalHandoffs > 0);
+
+  static inline bool has_locked_bit(const uint64_t val) { return val & kLockedBit; }
+
+  static inline bool is_version(const uint64_t val) { return !has_locked_bit(val); }
+
+  static inline uint64_t make_locked_version(const uint64_t v) {
+    assert(!has_locked_bit(v));
+    return v | kLockedBit;
+  }
+
+  static inline uint64_t next_version(const uint64_t v) {
+    uint64_t next = (v + kVersionStride) & ~kLockedBit;
+    return next == kInvalidVersion ? kVersionStride : next;
+  }
+
+ private:
+  static constexpr uint32_t kNotQueued = 0;
+  static constexpr uint64_t kQueueBits = 8;
+  static constexpr uint64_t kQueueMask = (1ull << kQueueBits) - 1;
+
+  static inline uint64_t make_grant(uint32_t queue, uint64_t handoffs) {
+    return (handoffs << kQueueBits) | queue;
+  }
+
+  static inline uint32_t grant_queue(uint64_t grant) { return grant & kQueueMask; }
+
+  static inline uint64_t grant_handoffs(uint64_t grant) { return grant >> kQueueBits; }
+
+  std::atomic<uint64_t> word_{0};
+#ifdef OMCS_COHORT_PADDED
+  // The tails start a full cache line after the lock word, so they never share
+  // its line whatever the alignment of the lock
+  char padding_[CACHELINE_SIZE - sizeof(word_)];
+#endif
+  std::atomic<OMCSQNode *> local_tails_[kMaxSockets]{};
+
+  inline void acquire_global() {
+    uint32_t cas_failure = 0;
+    while (true) {
+      uint64_t v = word_.load(std::memory_order_acquire);
+      if (has_locked_bit(v)) {
+        _mm_pause();
+        continue;
+      }
+      if (word_.compare_exchange_strong(v, make_locked_version(v))) {
+        return;
+      }
+      // Lost to another socket's head (or a qnode-less locker)
+      backoff::pause(++cas_failure);
+    }
+  }
+
+  inline void release_global() {
+    // Only the holder writes to a locked lock word
+    uint64_t v = word_.load(std::memory_order_relaxed);
+    assert(has_locked_bit(v));
+    word_.store(next_version(v & ~kLockedBit), std::memory_order_release);
+  }
+
+ public:
+  BasicOMCSCohortLock() = default;
+
+  BasicOMCSCohortLock(const BasicOMCSCohortLock &) = delete;
+  BasicOMCSCohortLock &operator=(const BasicOMCSCohortLock &) = delete;
+
+  uint64_t lock() {
+    uint32_t cas_failure = 0;
+    while (true) {
+      bool restart = false;
+      uint64_t version = try_begin_read(restart);
+      if (restart) {
+        continue;
+      }
+
+      uint64_t curr = version;
+      if (word_.compare_exchange_strong(curr, make_locked_version(version))) {
+        return version;
+      }
+      backoff::pause(++cas_failure);
+    }
+  }
+
+  bool try_lock(uint64_t version) {
+    if (!validate_read(version)) {
+      return false;
+    }
+
+    uint64_t curr = version;
+    return word_.compare_exchange_strong(curr, make_locked_version(version));
+  }
+
+  void unlock() { release_global(); }
+
+  void unlock(uint64_t v) {
+    (void)v;
+    unlock();
+  }
+
+  // There is no opportunistic read, so the caller never gets to read under a
+  // predecessor's lock
+  inline bool lock_begin(OMCSQNode *qnode) {
+    lock(qnode);
+    return false;
+  }
+
+  inline void lock_turn_off_opread() {}
+
+  inline void lock(OMCSQNode *qnode) { lock(qnode, nullptr); }
+
+  template <class Callback>
+  inline void lock(OMCSQNode *qnode, Callback &&cb) {
+    assert(qnode != nullptr);
+
+#ifndef NDEBUG
+    qnode->set_omcs(this);
+#endif
+
+    uint32_t queue = cohort_socket();
+    qnode->prepare_wait();
+    OMCSQNode *pred = local_tails_[queue].exchange(qnode);
+
+    uint64_t handoffs = 0;
+    if (pred) {
+      pred->set_next(qnode);
+      qnode->wait_for_grant();
+      handoffs = grant_handoffs(qnode->get_version());
+    }
+
+    if (handoffs == 0) {
+      // Head of the local queue: compete with the other sockets
+      acquire_global();
+      handoffs = 1;
+    }
+    qnode->set_version(make_grant(queue + 1, handoffs));
+
+    if constexpr (std::is_invocable_v<Callback>) {
+      cb();
+    }
+  }
+
+  inline bool try_lock(OMCSQNode *qnode, uint64_t version) {
+    assert(qnode != nullptr);
+
+#ifndef NDEBUG
+    qnode->set_omcs(this);
+#endif
+
+    if (!try_lock(version)) {
+      return false;
+    }
+    qnode->set_next(nullptr);
+    qnode->set_version(make_grant(kNotQueued, 0));
+    return true;
+  }
+
+  void unlock(OMCSQNode *qnode) {
+    assert(qnode != nullptr);
+
+#ifndef NDEBUG
+    qnode->assert_omcs(this);
+#endif
+
+    uint64_t grant = qnode->get_version();
+    uint32_t queue = grant_queue(grant);
+    if (queue == kNotQueued) {
+      release_global();
+      return;
+    }
+
+    std::atomic<OMCSQNode *> &tail = local_tails_[queue - 1];
+    OMCSQNode *succ = qnode->get_next();
+    if (succ == nullptr) {
+      OMCSQNode *self = qnode;
+      if (tail.compare_exchange_strong(self, nullptr)) {
+        // No one waiting on this socket
+        release_global();
+        return;
+      }
+      do {
+        succ = qnode->get_next();
+      } while (succ == nullptr);
+    }
+
+    uint64_t handoffs = grant_handoffs(grant);
+    if (handoffs < kMaxLocalHandoffs) {
+      // Pass the lock word to the local successor as is
+      succ->grant(make_grant(queue, handoffs + 1));
+    } else {
+      // Batch is full: let the other sockets in, and make the successor the
+      // new head of the local queue
+      release_global();
+      succ->grant(make_grant(queue, 0));
+    }
+  }
+
+  uint64_t begin_read() const {
+    while (true) {
+      bool restart = false;
+      uint64_t version = try_begin_read(restart);
+      if (!restart) {
+        return version;
+      }
+    }
+  }
+
+  uint64_t try_begin_read(bool &restart) const {
+    uint64_t version = word_.load(std::memory_order_acquire);
+    restart = has_locked_bit(version);
+    return version;
+  }
+
+  bool validate_read(uint64_t version) const {
+    assert(!has_locked_bit(version));
+    uint64_t v = word_.load(std::memory_order_acquire);
+    return version == v;
+  }
+
+  bool is_locked() const {
+    uint64_t version = word_.load(std::memory_order_acquire);
+    return has_locked_bit(version);
+  }
+};
+
+using OMCSCohortLock = BasicOMCSCohortLock<OMCSDefaultLayout>;
+
+}  // namespace omcs_impl
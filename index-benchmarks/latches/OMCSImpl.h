@@ -3,29 +3,143 @@
 #include <glog/logging.h>
 #include <immintrin.h>
 #include <stdint.h>
+#ifdef OMCS_SPIN_THEN_PARK
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(OMCS_SPIN_THEN_PARK) || defined(OMCS_ABORTABLE)
+#include <x86intrin.h>
+#endif
 
 #include <atomic>
 #include <cassert>
 #include <type_traits>
 
+#include "Backoff.h"
+#include "LockStats.h"
+#include "OMCSLayout.h"
+
 namespace omcs_impl {
 
 #ifndef CACHELINE_SIZE
 #define CACHELINE_SIZE 64
 #endif
 
-class OMCSLock;
+#ifdef OMCS_OP_READ_ADAPTIVE
+#ifndef OMCS_OP_READ
+#error "OMCS_OP_READ_ADAPTIVE requires OMCS_OP_READ"
+#endif
+#ifndef OMCS_OP_READ_WINDOW
+// Handoffs after the last reader restart for which readers are still let in
+#define OMCS_OP_READ_WINDOW 8
+#endif
+#endif
+
+// Waiters announce what they are doing in their queue node when they can park
+// or give up waiting
+#if defined(OMCS_SPIN_THEN_PARK) || defined(OMCS_ABORTABLE)
+#define OMCS_QNODE_WAIT_STATE
+#endif
+
+#ifdef OMCS_COMBINING
+#ifdef OMCS_ABORTABLE
+#error "OMCS_COMBINING and OMCS_ABORTABLE are mutually exclusive."
+#endif
+#ifndef OMCS_COMBINING_MAX_BATCH
+// Maximum number of waiters' operations a lock holder applies on their behalf
+// before handing the lock over
+#define OMCS_COMBINING_MAX_BATCH 8
+#endif
+#endif
+
+#if defined(OMCS_OBSOLETE_BIT) && defined(OMCS_OP_READ) && !defined(OMCS_OFFSET)
+// Opportunistic readers only see the holder's version (and thus the flag) in
+// the lock word with queue node IDs
+#error "OMCS_OBSOLETE_BIT with OMCS_OP_READ requires OMCS_OFFSET"
+#endif
+
+#ifdef OMCS_WRAPAROUND_GUARD
+// The epoch folds into the queue node ID bits of snapshots, and is process-local
+#ifndef OMCS_OFFSET
+#error "OMCS_WRAPAROUND_GUARD requires OMCS_OFFSET"
+#endif
+#if defined(OMCS_SHARED_MEMORY) || defined(ST_ONLY)
+#error "OMCS_WRAPAROUND_GUARD is not supported with OMCS_SHARED_MEMORY or ST_ONLY"
+#endif
+#endif
+
+#ifdef OMCS_SPIN_THEN_PARK
+#ifndef OMCS_PARK_SPIN_CYCLES
+// Roughly the cost of a futex sleep/wake round trip
+#define OMCS_PARK_SPIN_CYCLES 16384
+#endif
 
+// Queue nodes in the shared region are waited on and granted from different
+// processes, which a process-private futex would keep apart
+#ifdef OMCS_SHARED_MEMORY
+#define OMCS_FUTEX_WAIT FUTEX_WAIT
+#define OMCS_FUTEX_WAKE FUTEX_WAKE
+#else
+#define OMCS_FUTEX_WAIT FUTEX_WAIT_PRIVATE
+#define OMCS_FUTEX_WAKE FUTEX_WAKE_PRIVATE
+#endif
+#endif
+
+// By default [next_] and [version_] get a pair of cache lines each (which
+// also keeps the adjacent-line prefetcher from pairing them up), so a waiter
+// spinning on [version_] is not disturbed when its successor links up through
+// [next_]. That costs 256 bytes per queue node. With COMPACT_QNODE all fields
+// share one cache line: the spinning waiter takes one extra miss when its
+// successor arrives, and the queue node pools shrink by 4x.
+#ifdef COMPACT_QNODE
+struct alignas(CACHELINE_SIZE) OMCSQNode {
+ public:
+  std::atomic<OMCSQNode *> next_;
+  std::atomic<uint64_t> version_;
+#else
 struct alignas(CACHELINE_SIZE * 2) OMCSQNode {
  public:
   alignas(CACHELINE_SIZE * 2) std::atomic<OMCSQNode *> next_;
   alignas(CACHELINE_SIZE * 2) std::atomic<uint64_t> version_;
+#endif
+
+#ifdef OMCS_QNODE_WAIT_STATE
+  // Wait state of the owner of this queue node. This is also the futex word a
+  // parked waiter sleeps on; it shares the cache line with [version_] so that
+  // a grant only touches one line of the successor.
+  static constexpr uint32_t kSpinning = 0;
+  static constexpr uint32_t kParked = 1;
+  static constexpr uint32_t kGranted = 2;
+  // The owner timed out and left; the node stays in the queue until the lock
+  // holder skips it
+  static constexpr uint32_t kAbandoned = 3;
+  // Skipped by the lock holder; the owner may reuse the node
+  static constexpr uint32_t kSkipped = 4;
+  std::atomic<uint32_t> wait_state_;
+#endif
+
+#ifdef OMCS_OP_READ_ADAPTIVE
+  // Number of handoffs, including the one to this node's owner, for which
+  // readers are still let in although none of them asked for it lately.
+  // Handed down the queue together with the version.
+  uint32_t opread_credit_;
+#endif
+
+#ifdef OMCS_COMBINING
+  // Operation published by a waiter for the lock holder to apply on its
+  // behalf, see BasicOMCSLock::lock_or_combine. Returns false if it cannot be
+  // applied by someone else, in which case the waiter gets the lock.
+  bool (*combine_fn_)(void *);
+  void *combine_arg_;
+#endif
 
 #ifndef NDEBUG
-  OMCSLock *lock_;
+  // Not typed: queue nodes are shared by locks of all layouts
+  void *lock_;
 
-  void set_omcs(OMCSLock *lock) { lock_ = lock; }
-  void assert_omcs(OMCSLock *lock) { assert(lock_ == lock); }
+  void set_omcs(void *lock) { lock_ = lock; }
+  void assert_omcs(void *lock) { assert(lock_ == lock); }
 #endif
 
   inline void set_next(OMCSQNode *next) { next_.store(next, std::memory_order_release); }
@@ -35,12 +149,151 @@ struct alignas(CACHELINE_SIZE * 2) OMCSQNode {
   inline OMCSQNode *const get_next() const { return next_.load(std::memory_order_acquire); }
 
   inline const uint64_t get_version() const { return version_.load(std::memory_order_acquire); }
+
+#ifdef OMCS_QNODE_WAIT_STATE
+  inline void set_wait_state(uint32_t state) {
+    wait_state_.store(state, std::memory_order_release);
+  }
+
+  inline const uint32_t get_wait_state() const {
+    return wait_state_.load(std::memory_order_acquire);
+  }
+#endif
+
+  // Waiting for the predecessor to pass down the lock (and a version).
+  //
+  // By default a waiter spins on its own queue node forever, which is the
+  // right thing to do when there is one thread per core. With
+  // OMCS_SPIN_THEN_PARK, a waiter spins for at most OMCS_PARK_SPIN_CYCLES and
+  // then sleeps on the futex in its queue node, so that a preempted lock holder
+  // or predecessor can get the CPU back when threads are oversubscribed. The
+  // predecessor only issues the (expensive) wake-up if the waiter has actually
+  // announced that it is parked.
+  //
+  // The wait state, rather than [version_], is the last word the predecessor
+  // writes to the successor's queue node: the successor may return and reuse
+  // (or, for stack-allocated queue nodes, free) its queue node right after
+  // observing the grant. The futex_wake that may follow only uses the address.
+  //
+  // A grant is any value other than kNoGrant (i.e., the locks' kInvalidVersion).
+  static constexpr uint64_t kNoGrant = 0;
+#ifdef OMCS_COMBINING
+  // Granted instead of a version (which never has the lock bit) when the lock
+  // holder applied the waiter's operation: the waiter does not get the lock
+  static constexpr uint64_t kCombined = 1ull << 63;
+#endif
+
+  inline void prepare_wait() {
+    set_next(nullptr);
+    set_version(kNoGrant);
+#ifdef OMCS_OP_READ_ADAPTIVE
+    opread_credit_ = 0;
+#endif
+#ifdef OMCS_COMBINING
+    combine_fn_ = nullptr;
+#endif
+#ifdef OMCS_QNODE_WAIT_STATE
+    set_wait_state(kSpinning);
+#endif
+  }
+
+  inline void wait_for_grant() {
+#ifdef OMCS_SPIN_THEN_PARK
+    uint64_t start = __rdtsc();
+    while (get_wait_state() != kGranted) {
+      if (__rdtsc() - start < OMCS_PARK_SPIN_CYCLES) {
+        continue;
+      }
+      uint32_t expected = kSpinning;
+      if (wait_state_.compare_exchange_strong(expected, kParked) || expected == kParked) {
+        // Returns immediately if we got granted in the meantime
+        syscall(SYS_futex, &wait_state_, OMCS_FUTEX_WAIT, kParked, nullptr, nullptr, 0);
+      }
+    }
+    assert(get_version() != kNoGrant);
+#elif defined(OMCS_QNODE_WAIT_STATE)
+    while (get_wait_state() != kGranted) {
+    }
+#else
+    while (get_version() == kNoGrant) {
+    }
+#endif
+  }
+
+#ifdef OMCS_ABORTABLE
+  // Like wait_for_grant(), but gives up after [timeout_cycles] TSC cycles and
+  // abandons the queue node. Returns whether the lock was granted. Timed
+  // waiters always spin: they only wait for as long as the caller can afford.
+  inline bool wait_for_grant_for(uint64_t timeout_cycles) {
+    uint64_t start = __rdtsc();
+    while (get_wait_state() != kGranted) {
+      if (__rdtsc() - start < timeout_cycles) {
+        continue;
+      }
+      uint32_t expected = kSpinning;
+      if (wait_state_.compare_exchange_strong(expected, kAbandoned)) {
+        return false;
+      }
+      // Granted in the meantime
+      assert(expected == kGranted);
+    }
+    assert(get_version() != kNoGrant);
+    return true;
+  }
+
+  // Whether the queue node was abandoned and is still linked in a lock's
+  // queue; such a node must not be reused (or freed) until this turns false.
+  inline bool is_abandoned() const { return get_wait_state() == kAbandoned; }
+
+  // Called by the lock holder once it no longer needs the abandoned node,
+  // i.e., after reading its [next_]. Last access of the holder to the node.
+  inline void skip() {
+    assert(get_wait_state() == kAbandoned);
+    set_wait_state(kSkipped);
+  }
+#endif
+
+  // Returns false if the waiter has abandoned the queue node (OMCS_ABORTABLE)
+  inline bool grant(uint64_t version) {
+    assert(version != kNoGrant);
+    set_version(version);
+#ifdef OMCS_QNODE_WAIT_STATE
+#ifdef OMCS_ABORTABLE
+    uint32_t state = get_wait_state();
+    do {
+      if (state == kAbandoned) {
+        return false;
+      }
+    } while (!wait_state_.compare_exchange_weak(state, kGranted));
+#else
+    uint32_t state = wait_state_.exchange(kGranted);
+#endif
+#ifdef OMCS_SPIN_THEN_PARK
+    if (state == kParked) {
+      syscall(SYS_futex, &wait_state_, OMCS_FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+#endif
+#endif
+    return true;
+  }
 };
 
+#ifdef COMPACT_QNODE
+static_assert(sizeof(OMCSQNode) == CACHELINE_SIZE, "OMCSQNode does not fit in a cache line");
+#endif
+
 #ifdef OMCS_OFFSET
 extern OMCSQNode *base_qnode;
 #endif
 
+#ifdef OMCS_WRAPAROUND_GUARD
+// Bumped whenever the version of any lock wraps around; see BasicOMCSLock
+struct alignas(CACHELINE_SIZE) wraparound_epoch_t {
+  std::atomic<uint64_t> value{0};
+};
+inline wraparound_epoch_t wraparound_epoch;
+#endif
+
 /*
  * The OMCSLock class implements two different OMCS Locks: one that uses
  * virtual memory pointers to queue nodes, and one that uses queue node IDs.
@@ -60,13 +313,15 @@ extern OMCSQNode *base_qnode;
  * support in the system.  This can be passed in at runtime as a parameter to
  * the ctor.
  *
- * For simplicity, we fix it to be 1024 (so n = 10), as (1) usually a thread
+ * By default we fix it to be 1024 (so n = 10), as (1) usually a thread
  * only holds one lock, allowing us to support up to 1024 threads which is
  * fairly large in our target applications (DBMSs) that don't oversubscript the
  * system, and (2) our target applications usually don't take many locks at the
  * same time, e.g., lock coupling, in the worst case it's bounded by the tree
  * height which is typically not higher than a few levels. In any case, [n] is
- * adjustable either at runtime or compile-time.
+ * adjustable at compile-time through the [Layout] policy (see OMCSLayout.h),
+ * which comes with 1K, 4K and 16K queue node presets and statically checks the
+ * resulting wraparound horizon.
  *
  * Systems like FOEDUS already use this approach, although for a different
  * reason (to share queue nodes between processes, rather than making room for
@@ -81,11 +336,37 @@ extern OMCSQNode *base_qnode;
  * 2^52 / 100000000 ~= 45035996 seconds ~= 12509 hours = 521 days of up time
  * before wrapping up, which would require a quiescent point for all threads.
  *
+ * OMCS_WRAPAROUND_GUARD makes wraparound safe without one. Bumping a version
+ * past kVersionMask first bumps the global wraparound_epoch, and the
+ * snapshots handed out by try_begin_read() carry the low n bits of the epoch
+ * XOR-ed into their queue node ID bits. validate_read() folds the current
+ * epoch into the lock word the same way, so validation compares the version
+ * and the epoch at once (a "wide compare"): a snapshot taken before a
+ * wraparound of any lock fails to validate afterwards, even if the version
+ * has come back to the same value. Versions wrap rarely, so the epoch line
+ * stays shared in all caches; only 2^n wraparounds of locks during one read
+ * would go unnoticed. try_lock() takes such snapshots, and lock() returns the
+ * plain version.
+ *
  * For easier implementation, we encode the version number in LSBs because the
  * version number will never grow beyond 52 bits anyway:
  * |-63-|--62--|---------61-52--------|-----51-0-----|
  * |mode|opread|--tail queue node id--|version number|
  *
+ * With OMCS_OP_READ_ADAPTIVE, bit 61 is taken by a reader hint instead (and
+ * the version number shrinks by one bit, see OMCSLayout.h). Readers that find
+ * the lock held without the opread bit set the hint, so that the lock holder
+ * lets readers in during the next handoffs. Holders keep doing so for
+ * OMCS_OP_READ_WINDOW handoffs after the last hint, after which handoffs go
+ * without the atomic ops on the lock word for op-read again. Use is_opread()
+ * on a validated version to tell opportunistic reads apart.
+ *
+ * With OMCS_COMBINING, writers that queue up through lock_or_combine() publish
+ * their operation in their queue node, and a releasing lock holder applies up
+ * to OMCS_COMBINING_MAX_BATCH of them before handing the lock over (flat
+ * combining), so that the protected data stays in the holder's cache instead
+ * of migrating to every waiter's core.
+ *
  * To be NUMA-aware, the queue node should be allocated locally. There are two
  * approaches. The first one is to further partition the queue node id to
  * consist of a NUMA node id and a local node id. For now to fit our machine
@@ -113,32 +394,58 @@ extern OMCSQNode *base_qnode;
  * This is the current implementation when OMCS_OFFSET_NUMA_QNODE is defined.
  */
 
-class OMCSLock {
+template <class Layout>
+class BasicOMCSLock {
  public:
 #ifdef OMCS_OFFSET
-  static constexpr uint64_t kQueueNodeIdBits = 10;  // At most 1024 qnodes
-  static constexpr uint64_t kNumQueueNodes = 1 << kQueueNodeIdBits;
-  static constexpr uint64_t kVersionBits = 52;
-  static_assert(kQueueNodeIdBits + kVersionBits + 2 <= 64);
+  static constexpr uint64_t kQueueNodeIdBits = Layout::kQueueNodeIdBits;
+  static constexpr uint64_t kNumQueueNodes = Layout::kNumQueueNodes;
+  static constexpr uint64_t kVersionBits = Layout::kVersionBits;
 #endif
 
   static constexpr uint64_t kLockedBit = 1ull << 63;
 #ifdef OMCS_OP_READ
   static constexpr uint64_t kConsistentBit = 1ull << 62;
 #endif
-  static constexpr uint64_t kInvalidVersion = 0;
-  static constexpr uint64_t kVersionStride = 1;
+#ifdef OMCS_OP_READ_ADAPTIVE
+  static constexpr uint64_t kReaderHintBit = 1ull << 61;
+  static constexpr uint32_t kOpReadWindow = OMCS_OP_READ_WINDOW;
+#endif
+  static constexpr uint64_t kInvalidVersion = OMCSQNode::kNoGrant;
+  static constexpr uint64_t kVersionStride = Layout::kVersionStride;
   static constexpr uint64_t kNextUnlockedVersion = kVersionStride - kLockedBit;
+#ifdef OMCS_OBSOLETE_BIT
+  // Sticky flag below the version count, see OMCSLayout; versions skip it
+  static constexpr uint64_t kObsoleteBit = 1;
+  static_assert(kVersionStride == 2 * kObsoleteBit);
+#endif
 
 #ifdef OMCS_OFFSET
-  static constexpr uint64_t kVersionMask = 0xfffffffffffff;
-#ifdef OMCS_OP_READ
+  static constexpr uint64_t kVersionMask = Layout::kVersionMask;
+#if defined(OMCS_OP_READ_ADAPTIVE)
+  static constexpr uint64_t kQNodeIdMask =
+      ~(kVersionMask | kLockedBit | kConsistentBit | kReaderHintBit);
+#elif defined(OMCS_OP_READ)
   static constexpr uint64_t kQNodeIdMask = ~(kVersionMask | kLockedBit | kConsistentBit);
 #else
   static constexpr uint64_t kQNodeIdMask = ~(kVersionMask | kLockedBit);
 #endif  // OMCS_OP_READ
 #endif  // OMCS_OFFSET
 
+  // Bits that readers and the op-read handoff may add to a lock word that
+  // carries a queue node
+#if defined(OMCS_OP_READ_ADAPTIVE) && defined(OMCS_OFFSET)
+  static constexpr uint64_t kOpReadBits = kConsistentBit | kReaderHintBit | kVersionMask;
+#elif defined(OMCS_OP_READ_ADAPTIVE)
+  static constexpr uint64_t kOpReadBits = kConsistentBit | kReaderHintBit;
+#elif defined(OMCS_OP_READ) && defined(OMCS_OFFSET)
+  static constexpr uint64_t kOpReadBits = kConsistentBit | kVersionMask;
+#elif defined(OMCS_OP_READ)
+  static constexpr uint64_t kOpReadBits = kConsistentBit;
+#else
+  static constexpr uint64_t kOpReadBits = 0;
+#endif
+
   static constexpr int kMaxHTMRetries = 1024;
 
   template <typename T>
@@ -154,7 +461,10 @@ class OMCSLock {
     // [version] is a snapshot of the lock word
     return base_qnode + ((version & kQNodeIdMask) >> kVersionBits);
 #else
-#ifdef OMCS_OP_READ
+#if defined(OMCS_OP_READ_ADAPTIVE)
+    return reinterpret_cast<OMCSQNode *>(version &
+                                         (~(kLockedBit | kConsistentBit | kReaderHintBit)));
+#elif defined(OMCS_OP_READ)
     return reinterpret_cast<OMCSQNode *>(version & (~(kLockedBit | kConsistentBit)));
 #else
     return reinterpret_cast<OMCSQNode *>(version & ~kLockedBit);
@@ -176,32 +486,211 @@ class OMCSLock {
     return v | kLockedBit;
   }
 
+  // Version handed to the next lock holder. With queue node IDs the version
+  // must not carry into the ID bits, and must skip kInvalidVersion on wrap.
+  static inline uint64_t next_version(const uint64_t v) {
+#ifdef OMCS_OFFSET
+    uint64_t next = (v + kVersionStride) & kVersionMask;
+#ifdef OMCS_WRAPAROUND_GUARD
+    if (next < v) {
+      // Before the wrapped version can be seen
+      wraparound_epoch.value.fetch_add(1);
+    }
+#endif
+    return next == kInvalidVersion ? kVersionStride : next;
+#elif defined(OMCS_OP_READ_ADAPTIVE)
+    // A reader hint might have been left over from a centralized lock holder
+    return (v & ~kReaderHintBit) + kVersionStride;
+#else
+    return v + kVersionStride;
+#endif
+  }
+
+  // Version of a queue node whose exchange found the lock free: the old lock
+  // word [version] without what readers and the op-read handoff may have set
+  // on it, bumped for the new holder
+  static inline uint64_t granted_version(const uint64_t version) {
+    assert(is_version(version));
+#ifdef OMCS_OFFSET
+    assert((version & kQNodeIdMask) == 0);
+    return next_version(version & kVersionMask);
+#else
+    return next_version(version & ~kOpReadBits);
+#endif
+  }
+
+#ifdef OMCS_WRAPAROUND_GUARD
+  static inline uint64_t epoch_bits() {
+    uint64_t epoch = wraparound_epoch.value.load(std::memory_order_acquire);
+    return (epoch & (kNumQueueNodes - 1)) << kVersionBits;
+  }
+#else
+  static constexpr uint64_t epoch_bits() { return 0; }
+#endif
+
+  // Whether the lock word [version] was read while a writer held the lock,
+  // i.e., whether a successful read under it was an opportunistic read
+  static inline bool is_opread(const uint64_t version) { return has_locked_bit(version); }
+
+#ifdef OMCS_OBSOLETE_BIT
+  // [version] is a snapshot from try_begin_read() or lock(), including
+  // opportunistic reads (the holder's version is in the lock word then)
+  static inline bool is_obsolete(const uint64_t version) { return version & kObsoleteBit; }
+
+  // Whether the lock held through [qnode] was released as obsolete before
+  static inline bool is_obsolete(const OMCSQNode *qnode) {
+    return qnode->get_version() & kObsoleteBit;
+  }
+#endif
+
  private:
-  std::atomic<uint64_t> tail_{0};
+  // Mutable: with OMCS_OP_READ_ADAPTIVE, readers leave hints on the lock word
+  mutable std::atomic<uint64_t> tail_{0};
+
+  // Swings the tail from [self] back to the version [v] if no one has queued
+  // up behind us.
+  inline bool release_tail(uint64_t self, uint64_t v) {
+    uint64_t expected = self;
+#if defined(OMCS_OP_READ_ADAPTIVE) || defined(OMCS_ABORTABLE)
+    // Readers might have left a hint on the lock word in the meantime. After
+    // skipping abandoned queue nodes, the lock word also still carries the
+    // op-read bits we set for the abandoned successor.
+    while (!tail_.compare_exchange_strong(expected, v)) {
+      if ((expected & ~kOpReadBits) != self) {
+        return false;
+      }
+    }
+    return true;
+#else
+    return tail_.compare_exchange_strong(expected, v);
+#endif
+  }
+
+#ifdef OMCS_OP_READ
+  // Lets readers in during the handoff from [qnode]'s owner to its successor.
+  //
+  // With OMCS_OP_READ_ADAPTIVE this is only done if readers found the lock
+  // held (without the consistent bit) since the last handoff, or did so less
+  // than kOpReadWindow handoffs ago. Otherwise both this fetch_or and the
+  // successor's fetch_and to take the consistent bit off again are skipped.
+  // [credit] is the successor's share of the window.
+  //
+  // Returns whether the successor has to turn opportunistic read off.
+  inline bool allow_opread(OMCSQNode *qnode, uint32_t &credit) {
+#ifdef OMCS_OP_READ_ADAPTIVE
+    if (tail_.load(std::memory_order_relaxed) & kReaderHintBit) {
+      credit = kOpReadWindow;
+    } else if (qnode->opread_credit_ > 0) {
+      credit = qnode->opread_credit_ - 1;
+    } else {
+      credit = 0;
+      return false;
+    }
+#else
+    (void)credit;
+#endif
+#ifdef OMCS_OFFSET
+    // Add a special "allow to read" bit together with my (new) version
+    // number to give the readers a chance
+    tail_.fetch_or(kConsistentBit | qnode->get_version());
+#else
+    // Add a special "allow to read" bit to give the readers a chance
+    tail_.fetch_or(kConsistentBit);
+#endif  // OMCS_OFFSET
+    return true;
+  }
+
+  inline void turn_off_opread() {
+#if defined(OMCS_OFFSET) && defined(OMCS_OP_READ_ADAPTIVE)
+    // Also consume the readers' hint, which made our predecessor let them in
+    tail_.fetch_and(~(kConsistentBit | kReaderHintBit | kVersionMask));
+#elif defined(OMCS_OFFSET)
+    // Remove the consistent bit + version (actually not necessary to remove version, but just to be clear)
+    tail_.fetch_and(~(kConsistentBit | kVersionMask));
+#elif defined(OMCS_OP_READ_ADAPTIVE)
+    tail_.fetch_and(~(kConsistentBit | kReaderHintBit));
+#else
+    tail_.fetch_and(~kConsistentBit);
+#endif
+  }
+#endif  // OMCS_OP_READ
+
+  // Whether the predecessor that just granted us the lock let readers in, so
+  // that we have to turn opportunistic read off again. Always the case unless
+  // opportunistic read is adaptive: the predecessor then flags it in the
+  // granted version.
+  static inline bool opread_granted(OMCSQNode *qnode) {
+#ifdef OMCS_OP_READ_ADAPTIVE
+    uint64_t v = qnode->get_version();
+    if (v & kConsistentBit) {
+      qnode->set_version(v & ~kConsistentBit);
+      return true;
+    }
+    return false;
+#else
+    (void)qnode;
+    return true;
+#endif
+  }
+
+#ifdef OMCS_COMBINING
+  // Applies the operations that the waiters from [succ] on published, at most
+  // OMCS_COMBINING_MAX_BATCH of them, while [qnode]'s owner still holds the
+  // lock. Returns the waiter to hand the lock over to, or nullptr if the queue
+  // drained and the lock is released.
+  inline OMCSQNode *combine(OMCSQNode *qnode, OMCSQNode *succ) {
+    for (uint32_t i = 0; i < OMCS_COMBINING_MAX_BATCH; ++i) {
+      if (succ->combine_fn_ == nullptr || !succ->combine_fn_(succ->combine_arg_)) {
+        break;
+      }
+      // Done on [succ]'s behalf: leave it as if its owner had acquired and
+      // released the lock without changing the version. Readers cannot tell,
+      // as they have been locked out since we took the lock.
+      OMCSQNode *next = succ->get_next();
+      if (next == nullptr) {
+        if (release_tail(BasicOMCSLock::make_qnode_ptr(succ), qnode->get_version())) {
+          succ->grant(OMCSQNode::kCombined);
+          return nullptr;
+        }
+        do {
+          next = succ->get_next();
+        } while (next == nullptr);
+      }
+      // Last access to [succ]
+      succ->grant(OMCSQNode::kCombined);
+      succ = next;
+    }
+    return succ;
+  }
+#endif
 
  public:
-  OMCSLock() = default;
+  BasicOMCSLock() = default;
 
-  OMCSLock(const OMCSLock &) = delete;
-  OMCSLock &operator=(const OMCSLock &) = delete;
+  BasicOMCSLock(const BasicOMCSLock &) = delete;
+  BasicOMCSLock &operator=(const BasicOMCSLock &) = delete;
 
   uint64_t lock() {
     int cas_failure = 0;
+    [[maybe_unused]] bool held = false;
+    LOCK_STATS_WAIT_BEGIN(wait_start);
     while (true) {
       bool restart = false;
-      uint64_t version = try_begin_read(restart);
+      uint64_t version = load_version(restart);
       if (restart) {
+        held = true;
         continue;
       }
 
       uint64_t curr = version;
-      uint64_t locked = OMCSLock::make_locked_version(version);
+      uint64_t locked = BasicOMCSLock::make_locked_version(version);
       if (!tail_.compare_exchange_strong(curr, locked)) {
-        // XXX(shiges): This seem to hinder performance; maybe tune params?
-        // cas_failure++;
+        // See Backoff.h; no backoff by default
+        backoff::pause(++cas_failure);
         continue;
       }
       // lock acquired
+      LOCK_STATS_ACQUIRED(this, wait_start, held || cas_failure > 0);
       return version;
     }
   }
@@ -211,13 +700,38 @@ class OMCSLock {
       return false;
     }
 
+    // If the epoch has moved since, the CAS fails
+    version ^= epoch_bits();
     uint64_t curr = version;
-    uint64_t locked = OMCSLock::make_locked_version(version);
-    return tail_.compare_exchange_strong(curr, locked);
+    uint64_t locked = BasicOMCSLock::make_locked_version(version);
+    if (!tail_.compare_exchange_strong(curr, locked)) {
+      return false;
+    }
+    LOCK_STATS_INC(this, kAcquisitions);
+    return true;
   }
 
+#ifdef OMCS_OFFSET
+  // Whether adding [add] to the locked lock word [word] wraps the version
+  // around, which must not carry into the queue node ID bits
+  static inline bool unlock_wraps(uint64_t word, uint64_t add) {
+    return (word & kVersionMask) > kVersionMask - add;
+  }
+#endif
+
   void unlock() {
-    assert(OMCSLock::has_locked_bit(tail_.load()));
+    assert(BasicOMCSLock::has_locked_bit(tail_.load()));
+    // Only the holder changes the version of a locked lock word without queue
+    // nodes. With OMCS_OP_READ_ADAPTIVE readers may still set kReaderHintBit
+    // on it, which the plain stores below can drop; that is fine, as the next
+    // queue-based locker drops a hint found on a free lock word anyway.
+#ifdef OMCS_OFFSET
+    uint64_t word = tail_.load(std::memory_order_relaxed);
+    if (unlock_wraps(word, kVersionStride)) {
+      tail_.store(next_version(word & kVersionMask), std::memory_order_release);
+      return;
+    }
+#endif
 #if defined(NO_FAA)
     uint64_t v = tail_.load(std::memory_order_acquire);
     tail_.store(v + kNextUnlockedVersion, std::memory_order_release);
@@ -226,9 +740,25 @@ class OMCSLock {
 #endif
   }
 
+#ifdef OMCS_OBSOLETE_BIT
+  // Releases the lock and sets the obsolete flag for good
+  void unlock_obsolete() {
+    assert(BasicOMCSLock::has_locked_bit(tail_.load()));
+    assert(!is_obsolete(tail_.load()));
+#ifdef OMCS_OFFSET
+    uint64_t word = tail_.load(std::memory_order_relaxed);
+    if (unlock_wraps(word, kVersionStride + kObsoleteBit)) {
+      tail_.store(next_version(word & kVersionMask) | kObsoleteBit, std::memory_order_release);
+      return;
+    }
+#endif
+    tail_.fetch_add(kNextUnlockedVersion + kObsoleteBit);
+  }
+#endif
+
   void unlock(uint64_t v) {
 #if defined(ST_ONLY)
-    assert(!(OMCSLock::has_locked_bit(v)));
+    assert(!(BasicOMCSLock::has_locked_bit(v)));
     tail_.store(v + kVersionStride, std::memory_order_release);
 #else
     (void)v;
@@ -243,44 +773,34 @@ class OMCSLock {
     qnode->set_omcs(this);
 #endif
 
-    qnode->set_next(nullptr);
-    qnode->set_version(OMCSLock::kInvalidVersion);
-    uint64_t self = OMCSLock::make_qnode_ptr(qnode);
+    qnode->prepare_wait();
+    uint64_t self = BasicOMCSLock::make_qnode_ptr(qnode);
     uint64_t version = tail_.exchange(self);
 
-    if (OMCSLock::is_version(version)) {
-#ifdef OMCS_OFFSET
-      assert((version & kQNodeIdMask) == 0);
-      // Doesn't matter if opread is enabled, we need to apply the mask
-      uint64_t v0 = version & kVersionMask;
-#else
-#ifdef OMCS_OP_READ
-      uint64_t v0 = version & ~kConsistentBit;
-#else
-      uint64_t v0 = version;
-#endif  // OMCS_OP_READ
-#endif  // OMCS_OFFSET
-      uint64_t v1 = v0 + kVersionStride;
-      qnode->set_version(v1);
+    if (BasicOMCSLock::is_version(version)) {
+      qnode->set_version(granted_version(version));
+      LOCK_STATS_INC(this, kAcquisitions);
       return false;
     }
 
-    OMCSQNode *pred = OMCSLock::get_qnode_ptr(version);
+    OMCSQNode *pred = BasicOMCSLock::get_qnode_ptr(version);
     pred->set_next(qnode);
-
-    while (qnode->get_version() == OMCSLock::kInvalidVersion) {
+#ifdef OMCS_OP_READ_ADAPTIVE
+    if (version & kReaderHintBit) {
+      // Our exchange wiped the readers' hint off the lock word; put it back
+      tail_.fetch_or(kReaderHintBit);
     }
-    return true;
+#endif
+
+    LOCK_STATS_WAIT_BEGIN(wait_start);
+    qnode->wait_for_grant();
+    LOCK_STATS_ACQUIRED(this, wait_start, true);
+    return opread_granted(qnode);
   }
 
   inline void lock_turn_off_opread() {
 #ifdef OMCS_OP_READ
-#ifdef OMCS_OFFSET
-    // Remove the consistent bit + version (actually not necessary to remove version, but just to be clear)
-    tail_.fetch_and(~(kConsistentBit | kVersionMask));
-#else
-    tail_.fetch_and(~kConsistentBit);
-#endif
+    turn_off_opread();
 #endif
   }
 
@@ -294,25 +814,13 @@ class OMCSLock {
     qnode->set_omcs(this);
 #endif
 
-    qnode->set_next(nullptr);
-    qnode->set_version(OMCSLock::kInvalidVersion);
-    uint64_t self = OMCSLock::make_qnode_ptr(qnode);
+    qnode->prepare_wait();
+    uint64_t self = BasicOMCSLock::make_qnode_ptr(qnode);
     uint64_t version = tail_.exchange(self);
 
-    if (OMCSLock::is_version(version)) {
-#ifdef OMCS_OFFSET
-      assert((version & kQNodeIdMask) == 0);
-      // Doesn't matter if opread is enabled, we need to apply the mask
-      uint64_t v0 = version & kVersionMask;
-#else
-#ifdef OMCS_OP_READ
-      uint64_t v0 = version & ~kConsistentBit;
-#else
-      uint64_t v0 = version;
-#endif  // OMCS_OP_READ
-#endif  // OMCS_OFFSET
-      uint64_t v1 = v0 + kVersionStride;
-      qnode->set_version(v1);
+    if (BasicOMCSLock::is_version(version)) {
+      qnode->set_version(granted_version(version));
+      LOCK_STATS_INC(this, kAcquisitions);
 
       if constexpr (std::is_invocable_v<Callback>) {
         cb();
@@ -320,11 +828,21 @@ class OMCSLock {
       return;
     }
 
-    OMCSQNode *pred = OMCSLock::get_qnode_ptr(version);
+    OMCSQNode *pred = BasicOMCSLock::get_qnode_ptr(version);
     pred->set_next(qnode);
-
-    while (qnode->get_version() == OMCSLock::kInvalidVersion) {
+#ifdef OMCS_OP_READ_ADAPTIVE
+    if (version & kReaderHintBit) {
+      // Our exchange wiped the readers' hint off the lock word; put it back
+      tail_.fetch_or(kReaderHintBit);
     }
+#endif
+
+    LOCK_STATS_WAIT_BEGIN(wait_start);
+    qnode->wait_for_grant();
+    LOCK_STATS_ACQUIRED(this, wait_start, true);
+#ifdef OMCS_OP_READ
+    bool opread = opread_granted(qnode);
+#endif
 
 #if !defined(OMCS_OP_READ_NEW_API_CALLBACK_BASELINE)
     if constexpr (std::is_invocable_v<Callback>) {
@@ -332,12 +850,9 @@ class OMCSLock {
     }
 #endif
 #ifdef OMCS_OP_READ
-#ifdef OMCS_OFFSET
-    // Remove the consistent bit + version (actually not necessary to remove version, but just to be clear)
-    tail_.fetch_and(~(kConsistentBit | kVersionMask));
-#else
-    tail_.fetch_and(~kConsistentBit);
-#endif
+    if (opread) {
+      turn_off_opread();
+    }
 #endif
 #if defined(OMCS_OP_READ_NEW_API_CALLBACK_BASELINE)
     if constexpr (std::is_invocable_v<Callback>) {
@@ -346,10 +861,108 @@ class OMCSLock {
 #endif
   }
 
+#ifdef OMCS_COMBINING
+  // Flat-combining acquisition: [fn]([arg]) is published in the queue node
+  // before queueing up, and the lock holders ahead of us may run it on our
+  // behalf (under the lock, while we still wait) instead of handing over the
+  // lock. Returns false if that happened. Otherwise, including when [fn]
+  // declined by returning false, returns true with the lock held, and the
+  // caller performs the operation itself.
+  inline bool lock_or_combine(OMCSQNode *qnode, bool (*fn)(void *), void *arg) {
+    assert(qnode != nullptr && fn != nullptr);
+
+#ifndef NDEBUG
+    qnode->set_omcs(this);
+#endif
+
+    qnode->prepare_wait();
+    qnode->combine_fn_ = fn;
+    qnode->combine_arg_ = arg;
+    uint64_t self = BasicOMCSLock::make_qnode_ptr(qnode);
+    uint64_t version = tail_.exchange(self);
+
+    if (BasicOMCSLock::is_version(version)) {
+      qnode->set_version(granted_version(version));
+      LOCK_STATS_INC(this, kAcquisitions);
+      return true;
+    }
+
+    OMCSQNode *pred = BasicOMCSLock::get_qnode_ptr(version);
+    pred->set_next(qnode);
+#ifdef OMCS_OP_READ_ADAPTIVE
+    if (version & kReaderHintBit) {
+      // Our exchange wiped the readers' hint off the lock word; put it back
+      tail_.fetch_or(kReaderHintBit);
+    }
+#endif
+
+    LOCK_STATS_WAIT_BEGIN(wait_start);
+    qnode->wait_for_grant();
+    LOCK_STATS_ACQUIRED(this, wait_start, true);
+    if (qnode->get_version() == OMCSQNode::kCombined) {
+      return false;
+    }
+#ifdef OMCS_OP_READ
+    if (opread_granted(qnode)) {
+      turn_off_opread();
+    }
+#endif
+    return true;
+  }
+#endif  // OMCS_COMBINING
+
+#ifdef OMCS_ABORTABLE
+  // Queue-based acquisition that waits for at most [timeout_cycles] TSC cycles
+  // (MCS-timeout style). On timeout the queue node is abandoned in place: it
+  // stays linked in the queue and the lock holder skips it when handing over
+  // the lock. The caller must then not reuse or free it while
+  // qnode->is_abandoned() holds, i.e., until the holder got past it.
+  inline bool try_lock_for(OMCSQNode *qnode, uint64_t timeout_cycles) {
+    assert(qnode != nullptr);
+
+#ifndef NDEBUG
+    qnode->set_omcs(this);
+#endif
+
+    qnode->prepare_wait();
+    uint64_t self = BasicOMCSLock::make_qnode_ptr(qnode);
+    uint64_t version = tail_.exchange(self);
+
+    if (BasicOMCSLock::is_version(version)) {
+      qnode->set_version(granted_version(version));
+      LOCK_STATS_INC(this, kAcquisitions);
+      return true;
+    }
+
+    OMCSQNode *pred = BasicOMCSLock::get_qnode_ptr(version);
+    pred->set_next(qnode);
+#ifdef OMCS_OP_READ_ADAPTIVE
+    if (version & kReaderHintBit) {
+      // Our exchange wiped the readers' hint off the lock word; put it back
+      tail_.fetch_or(kReaderHintBit);
+    }
+#endif
+
+    LOCK_STATS_WAIT_BEGIN(wait_start);
+    if (!qnode->wait_for_grant_for(timeout_cycles)) {
+      return false;
+    }
+    LOCK_STATS_ACQUIRED(this, wait_start, true);
+#ifdef OMCS_OP_READ
+    if (opread_granted(qnode)) {
+      turn_off_opread();
+    }
+#endif
+    return true;
+  }
+#endif  // OMCS_ABORTABLE
+
   inline bool try_lock(OMCSQNode *qnode, uint64_t version) {
     if (!validate_read(version)) {
       return false;
     }
+    // If the epoch has moved since, the CAS fails
+    version ^= epoch_bits();
 
     assert(qnode != nullptr);
 
@@ -358,15 +971,22 @@ class OMCSLock {
 #endif
 
     uint64_t v0 = version;
-    uint64_t v1 = v0 + kVersionStride;
+    uint64_t v1 = next_version(v0);
 
     qnode->set_next(nullptr);
     qnode->set_version(v1);
+#ifdef OMCS_OP_READ_ADAPTIVE
+    qnode->opread_credit_ = 0;
+#endif
 
     uint64_t curr = version;
-    uint64_t self = OMCSLock::make_qnode_ptr(qnode);
+    uint64_t self = BasicOMCSLock::make_qnode_ptr(qnode);
 
-    return tail_.compare_exchange_strong(curr, self);
+    if (!tail_.compare_exchange_strong(curr, self)) {
+      return false;
+    }
+    LOCK_STATS_INC(this, kAcquisitions);
+    return true;
   }
 
   void unlock(OMCSQNode *qnode) {
@@ -376,46 +996,87 @@ class OMCSLock {
     qnode->assert_omcs(this);
 #endif
 
+#ifdef OMCS_OP_READ
+    [[maybe_unused]] bool opread = false;
+    [[maybe_unused]] uint32_t credit = 0;
+#endif
+
     OMCSQNode *succ = qnode->get_next();
+#ifdef OMCS_COMBINING
+    if (succ != nullptr) {
+      succ = combine(qnode, succ);
+      if (succ == nullptr) {
+        return;
+      }
+    }
+#endif
     if (succ == nullptr) {
       uint64_t v0 = qnode->get_version();
-      assert(!OMCSLock::has_locked_bit(v0));
-      uint64_t self = OMCSLock::make_qnode_ptr(qnode);
-      if (tail_.compare_exchange_strong(self, v0)) {
+      assert(!BasicOMCSLock::has_locked_bit(v0));
+      uint64_t self = BasicOMCSLock::make_qnode_ptr(qnode);
+      if (release_tail(self, v0)) {
         return;
       }
 
 #ifdef OMCS_OP_READ
-#ifdef OMCS_OFFSET
-      // Add a special "allow to read" bit together with my (new) version
-      // number to give the readers a chance
-      tail_.fetch_or(kConsistentBit | qnode->get_version());
-#else
-      // Add a special "allow to read" bit to give the readers a chance
-      tail_.fetch_or(kConsistentBit);
-#endif  // OMCS_OFFSET
-#endif  // OMCS_OP_READ
+      opread = allow_opread(qnode, credit);
+#endif
 
       do {
         succ = qnode->get_next();
       } while (succ == nullptr);
     } else {
 #ifdef OMCS_OP_READ
-      // Add a special "allow to read" bit to give the readers a chance
-#ifdef OMCS_OFFSET
-      tail_.fetch_or(kConsistentBit | qnode->get_version());
-#else
-      tail_.fetch_or(kConsistentBit);
-#endif
+      opread = allow_opread(qnode, credit);
 #endif
     }
 
     assert(succ != nullptr);
     uint64_t v0 = qnode->get_version();
-    uint64_t v1 = v0 + kVersionStride;
-    assert(v1 != OMCSLock::kInvalidVersion);
-    succ->set_version(v1);
+    uint64_t v1 = next_version(v0);
+    assert(v1 != BasicOMCSLock::kInvalidVersion);
+#ifdef OMCS_OP_READ_ADAPTIVE
+    if (opread) {
+      // Tell the successor to turn opportunistic read off again
+      v1 |= kConsistentBit;
+    }
+#endif
+
+    while (true) {
+#ifdef OMCS_OP_READ_ADAPTIVE
+      succ->opread_credit_ = credit;
+#endif
+      if (succ->grant(v1)) {
+        return;
+      }
+#ifdef OMCS_ABORTABLE
+      // [succ] timed out: skip its queue node, as if its owner had acquired
+      // and released the lock without changing the version
+      OMCSQNode *abandoned = succ;
+      succ = abandoned->get_next();
+      if (succ == nullptr) {
+        if (release_tail(BasicOMCSLock::make_qnode_ptr(abandoned), v0)) {
+          abandoned->skip();
+          return;
+        }
+        do {
+          succ = abandoned->get_next();
+        } while (succ == nullptr);
+      }
+      abandoned->skip();
+#endif
+    }
+  }
+
+#ifdef OMCS_OBSOLETE_BIT
+  // The flag travels with the version to the successor or back to the lock
+  // word
+  void unlock_obsolete(OMCSQNode *qnode) {
+    assert(!is_obsolete(qnode));
+    qnode->set_version(qnode->get_version() | kObsoleteBit);
+    unlock(qnode);
   }
+#endif
 
   uint64_t begin_read() const {
     while (true) {
@@ -427,12 +1088,26 @@ class OMCSLock {
     }
   }
 
+  // Snapshot for validate_read() and try_lock()
   uint64_t try_begin_read(bool &restart) const {
+    // The epoch before the version, see OMCS_WRAPAROUND_GUARD
+    uint64_t epoch = epoch_bits();
+    return load_version(restart) ^ epoch;
+  }
+
+  // Like try_begin_read(), but returns the lock word as is
+  uint64_t load_version(bool &restart) const {
     uint64_t version = tail_.load(std::memory_order_acquire);
 #ifdef OMCS_OP_READ
-    restart = OMCSLock::has_locked_bit(version) && !(version & kConsistentBit);
+    restart = BasicOMCSLock::has_locked_bit(version) && !(version & kConsistentBit);
+#ifdef OMCS_OP_READ_ADAPTIVE
+    if (restart && !(version & kReaderHintBit)) {
+      // Ask the lock holder to let readers in during the next handoffs
+      tail_.fetch_or(kReaderHintBit);
+    }
+#endif
 #else
-    restart = OMCSLock::has_locked_bit(version);
+    restart = BasicOMCSLock::has_locked_bit(version);
 #endif
     // If [restart] hasn't been changed to false, [version]
     // is guaranteed to be a version.
@@ -441,16 +1116,25 @@ class OMCSLock {
 
   bool validate_read(uint64_t version) const {
 #ifndef OMCS_OP_READ
-    assert(!OMCSLock::has_locked_bit(version));
+    assert(!BasicOMCSLock::has_locked_bit(version));
+#endif
+    uint64_t v = tail_.load(std::memory_order_acquire) ^ epoch_bits();
+#ifdef LOCK_STATS
+    if (version != v) {
+      LOCK_STATS_INC(this, kValidateFailures);
+    } else if (BasicOMCSLock::has_locked_bit(version)) {
+      LOCK_STATS_INC(this, kOpReadSuccesses);
+    }
 #endif
-    uint64_t v = tail_.load(std::memory_order_acquire);
     return version == v;
   }
 
   bool is_locked() const {
     uint64_t version = tail_.load(std::memory_order_acquire);
-    return OMCSLock::has_locked_bit(version);
+    return BasicOMCSLock::has_locked_bit(version);
   }
 };
 
+using OMCSLock = BasicOMCSLock<OMCSDefaultLayout>;
+
 }  // namespace omcs_impl
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace omcs_impl {
+
+// Shortest acceptable time before a lock's version number wraps around under
+// the (very high) rate of kWraparoundOpsPerSecond lock acquisitions. A reader
+// holding a snapshot across a full wraparound would validate successfully, so
+// this is what bounds the ABA window of optimistic and opportunistic reads.
+#ifndef OMCS_MIN_WRAPAROUND_DAYS
+#define OMCS_MIN_WRAPAROUND_DAYS 7
+#endif
+
+// OMCS_VERSION_BITS narrows the version (OMCS_OFFSET) to make it wrap around
+// within a test run; the wraparound check above is skipped then.
+
+/*
+ * Layout of the lock word when queue nodes are referred to by IDs
+ * (OMCS_OFFSET):
+ *
+ * |-63-|--62--|---61-(62-n)---|--(61-n)-0--|
+ * |mode|opread|-queue node id-|---version--|
+ *
+ * where n = QNodeIdBits. Every bit given to queue node IDs (i.e., to more
+ * threads/in-flight lock holders) halves the time before versions wrap.
+ *
+ * Adaptive opportunistic read (OMCS_OP_READ_ADAPTIVE) takes bit 61 for the
+ * readers' hint, so the queue node id and version move down by one bit.
+ *
+ * With OMCS_OBSOLETE_BIT, bit 0 of the version is a sticky flag for the data
+ * structure (e.g., ART's obsolete nodes) and versions count in steps of two,
+ * so readers validate the flag and the version with the same compare. This
+ * applies with and without queue node IDs.
+ *
+ * With OMCS_WRAPAROUND_GUARD, the lock's snapshots (but not the lock word)
+ * also carry a wraparound epoch, see BasicOMCSLock.
+ */
+template <uint64_t QNodeIdBits>
+struct OMCSLayout {
+  static constexpr uint64_t kQueueNodeIdBits = QNodeIdBits;
+  static constexpr uint64_t kNumQueueNodes = 1ull << kQueueNodeIdBits;
+#ifdef OMCS_OP_READ_ADAPTIVE
+  static constexpr uint64_t kFlagBits = 3;
+#else
+  static constexpr uint64_t kFlagBits = 2;
+#endif
+#ifdef OMCS_VERSION_BITS
+  static constexpr uint64_t kVersionBits = OMCS_VERSION_BITS;
+#else
+  static constexpr uint64_t kVersionBits = 64 - kFlagBits - kQueueNodeIdBits;
+#endif
+  static constexpr uint64_t kVersionMask = (1ull << kVersionBits) - 1;
+  static_assert(kQueueNodeIdBits + kVersionBits + kFlagBits <= 64);
+#ifdef OMCS_OBSOLETE_BIT
+  static constexpr uint64_t kVersionStride = 2;
+#else
+  static constexpr uint64_t kVersionStride = 1;
+#endif
+
+  static constexpr uint64_t kWraparoundOpsPerSecond = 100000000;
+  static constexpr uint64_t kWraparoundSeconds =
+      kVersionMask / kVersionStride / kWraparoundOpsPerSecond;
+#ifndef OMCS_VERSION_BITS
+  static_assert(kWraparoundSeconds >= OMCS_MIN_WRAPAROUND_DAYS * 24 * 3600,
+                "Too few version bits: versions would wrap around too soon");
+#endif
+};
+
+using OMCSLayout1K = OMCSLayout<10>;   // 52-bit versions, ~521 days at 100M ops/s
+using OMCSLayout4K = OMCSLayout<12>;   // 50-bit versions, ~130 days at 100M ops/s
+using OMCSLayout16K = OMCSLayout<14>;  // 48-bit versions, ~32 days at 100M ops/s
+
+#if defined(OMCS_QNODES_16K)
+using OMCSDefaultLayout = OMCSLayout16K;
+#elif defined(OMCS_QNODES_4K) || defined(BTREE_RWLOCK_MCSRW_ONLY)
+// XXX(shiges): MCSRW-only lock coupling might need 8-9 qnodes per thread
+using OMCSDefaultLayout = OMCSLayout4K;
+#else
+using OMCSDefaultLayout = OMCSLayout1K;
+#endif
+
+}  // namespace omcs_impl
@@ -1,8 +1,14 @@
 #pragma once
 
 #include <numa.h>
+#include <sched.h>
+#ifdef OMCS_SHARED_MEMORY
+#include <pthread.h>
+#endif
 
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 #if defined(OMCS_LOCK)
 #include "OMCSImpl.h"
@@ -10,6 +16,21 @@
 #include "MCSRW.h"
 #endif
 
+// With OMCS_SHARED_MEMORY the qnodes and the pools handing them out live in the
+// shared region (see common/shared_region.h), which must be created or attached
+// to before init_qnodes(). Lock words only carry qnode IDs, so locks in the
+// region work for all processes mapping it.
+#ifdef OMCS_SHARED_MEMORY
+#ifndef OMCS_OFFSET
+#error "OMCS_SHARED_MEMORY requires OMCS_OFFSET"
+#endif
+#include "../common/shared_region.h"
+#endif
+
+#ifdef OMCS_OFFSET_NUMA_QNODE
+#include "../common/topology.h"
+#endif
+
 #ifdef OMCS_OFFSET
 #if defined(OMCS_LOCK)
 namespace offset {
@@ -37,42 +58,198 @@ using omcs_impl::base_qnode;
 #elif defined(MCSRW_LOCK) || defined(OPT_MCSRW_HYBRID_LOCK)
 using mcsrw::base_qnode;
 #endif
+
+#ifdef BTREE_RWLOCK_MCSRW_ONLY
+// XXX(shiges): we might need 8-9 qnodes for our workloads
+constexpr uint32_t QNODES_PER_THREAD = 16;
+#else
+// XXX(shiges): grab 4 qnodes every time
+constexpr uint32_t QNODES_PER_THREAD = 4;
+#endif
+
 #ifdef OMCS_OFFSET_NUMA_QNODE
 #define PAGE_SIZE 4096
-struct socket_queue_node_index {
-  std::atomic<uint64_t> index;
-  char padding[CACHELINE_SIZE - sizeof(index)];
+static_assert(PAGE_SIZE % sizeof(QNode) == 0);
+constexpr uint32_t kQNodesPerPage = PAGE_SIZE / sizeof(QNode);
+// A thread's block of qnodes must not straddle two pages (i.e., two sockets)
+static_assert(kQNodesPerPage % QNODES_PER_THREAD == 0);
+#endif  // OMCS_OFFSET_NUMA_QNODE
+
+#ifdef OMCS_SHARED_MEMORY
+// Fixed-capacity free list, so that a pool can live in the shared region
+struct qnode_block_stack {
+  uint32_t size = 0;
+  uint32_t blocks[Lock::kNumQueueNodes / QNODES_PER_THREAD];
+
+  bool empty() const { return size == 0; }
+  uint32_t back() const { return blocks[size - 1]; }
+  void pop_back() { --size; }
+  void push_back(uint32_t block) { blocks[size++] = block; }
 };
-inline socket_queue_node_index *socket_qnode_index;
+#endif
+
+// Queue nodes are handed out to threads in blocks of QNODES_PER_THREAD. Each
+// socket owns the blocks that live on its memory: fresh blocks are carved out
+// with a bump index and blocks of exited threads are pushed onto the socket's
+// free list for reuse. Without OMCS_OFFSET_NUMA_QNODE there is a single pool.
+struct alignas(CACHELINE_SIZE) socket_qnode_pool {
+#ifdef OMCS_SHARED_MEMORY
+  shm::spin_mutex mutex;
+  uint32_t next_block;
+  uint32_t nblocks;
+  qnode_block_stack free_blocks;
 #else
-inline std::atomic<uint64_t> next_node(0);
-#endif  // OMCS_OFFSET_NUMA_QNODE
+  std::mutex mutex;
+  uint32_t next_block;
+  uint32_t nblocks;
+  std::vector<uint32_t> free_blocks;
+#endif
+};
+inline socket_qnode_pool *qnode_pools = nullptr;
+inline uint32_t nqnode_pools = 0;
+
+#ifdef OMCS_SHARED_MEMORY
+// Published in the shared region for processes that attach to it
+struct shared_qnodes {
+  QNode *base;
+  socket_qnode_pool *pools;
+  uint32_t npools;
+};
+#endif
+
+// Index into base_qnode of the first qnode in [block] of [socket]
+inline uint32_t qnode_block_index(uint32_t socket, uint32_t block) {
+  uint32_t index = block * QNODES_PER_THREAD;
+#ifdef OMCS_OFFSET_NUMA_QNODE
+  uint32_t page_num = index / kQNodesPerPage * nqnode_pools + socket;
+  index = page_num * kQNodesPerPage + index % kQNodesPerPage;
+#endif
+  return index;
+}
+
+inline uint32_t current_qnode_pool() {
+#ifdef OMCS_OFFSET_NUMA_QNODE
+  return topology::current_node() % nqnode_pools;
+#else
+  return 0;
+#endif
+}
+
+inline bool try_acquire_qnode_block(uint32_t socket, uint32_t &block) {
+  socket_qnode_pool &pool = qnode_pools[socket];
+  std::lock_guard<decltype(pool.mutex)> guard(pool.mutex);
+  if (!pool.free_blocks.empty()) {
+    block = pool.free_blocks.back();
+    pool.free_blocks.pop_back();
+    return true;
+  }
+  if (pool.next_block < pool.nblocks) {
+    block = pool.next_block++;
+    return true;
+  }
+  return false;
+}
+
+// Prefer the given socket; fall back to remote qnodes before giving up
+inline void acquire_qnode_block(uint32_t preferred, uint32_t &socket, uint32_t &block) {
+  for (uint32_t i = 0; i < nqnode_pools; ++i) {
+    socket = (preferred + i) % nqnode_pools;
+    if (try_acquire_qnode_block(socket, block)) {
+      return;
+    }
+  }
+  // Handing out more qnodes would overflow the qnode id bits in lock words
+  std::cerr << "Out of queue nodes: all " << Lock::kNumQueueNodes / QNODES_PER_THREAD
+            << " blocks of " << QNODES_PER_THREAD << " qnodes are held by live threads"
+            << std::endl;
+  abort();
+}
+
+inline void release_qnode_block(uint32_t socket, uint32_t block) {
+  socket_qnode_pool &pool = qnode_pools[socket];
+  std::lock_guard<decltype(pool.mutex)> guard(pool.mutex);
+  pool.free_blocks.push_back(block);
+}
+
+// Returns the thread's block to its pool when the thread exits
+struct thread_qnode_block {
+  static constexpr uint32_t kNone = ~0u;
+  uint32_t socket = kNone;
+  uint32_t block = kNone;
+
+  ~thread_qnode_block() {
+    if (socket != kNone) {
+      release_qnode_block(socket, block);
+    }
+  }
+};
+
+inline socket_qnode_pool *new_qnode_pools(uint32_t n) {
+#ifdef OMCS_SHARED_MEMORY
+  auto *pools = static_cast<socket_qnode_pool *>(
+      shm::allocate(sizeof(socket_qnode_pool) * n, alignof(socket_qnode_pool)));
+  for (uint32_t i = 0; i < n; ++i) {
+    new (pools + i) socket_qnode_pool;
+  }
+  return pools;
+#else
+  return new socket_qnode_pool[n];
+#endif
+}
+
+#ifdef OMCS_SHARED_MEMORY
+inline void forget_tls_qnodes();
+#endif
 #endif  // OMCS_OFFSET
 
 inline void init_qnodes() {
 #ifdef OMCS_OFFSET
+  // Qnodes (and the blocks held by running threads) stay valid across trees
+  if (base_qnode) {
+    return;
+  }
+#ifdef OMCS_SHARED_MEMORY
+  // A fork()ed child's thread starts out with its parent's qnodes
+  pthread_atfork(nullptr, nullptr, forget_tls_qnodes);
+  if (auto *shared = shm::lookup<shared_qnodes>(shm::kQNodes)) {
+    // Set up by another process
+    base_qnode = shared->base;
+    qnode_pools = shared->pools;
+    nqnode_pools = shared->npools;
+    return;
+  }
+#endif
 #ifdef OMCS_OFFSET_NUMA_QNODE
-  static_assert(PAGE_SIZE % sizeof(QNode) == 0);
-
   // Round up to the proper number of pages
-  uint32_t qnodes_per_page = PAGE_SIZE / sizeof(QNode);
   uint32_t npages = 0;
   uint32_t qnodes = 0;
   uint32_t sockets = numa_max_node() + 1;
   while (qnodes < Lock::kNumQueueNodes) {
-    qnodes += qnodes_per_page * sockets;
+    qnodes += kQNodesPerPage * sockets;
     npages += sockets;
   }
 
   std::cout << "Allocated " << qnodes << " queue nodes over " << npages << " pages across "
             << sockets << " sockets" << std::endl;
 
-  socket_qnode_index = (socket_queue_node_index *)malloc(sockets * sizeof(socket_queue_node_index));
+  nqnode_pools = sockets;
+  qnode_pools = new_qnode_pools(sockets);
   for (uint32_t i = 0; i < sockets; ++i) {
-    socket_qnode_index[i].index = 0;
+    // Only hand out blocks whose qnode ids fit in a lock word
+    uint32_t nblocks = 0;
+    while (qnode_block_index(i, nblocks) + QNODES_PER_THREAD <= Lock::kNumQueueNodes) {
+      ++nblocks;
+    }
+    qnode_pools[i].next_block = 0;
+    qnode_pools[i].nblocks = nblocks;
   }
 
+#ifdef OMCS_SHARED_MEMORY
+  base_qnode = (QNode *)shm::allocate(npages * PAGE_SIZE, PAGE_SIZE);
+  numa_interleave_memory(base_qnode, npages * PAGE_SIZE, numa_all_nodes_ptr);
+#else
   base_qnode = (QNode *)numa_alloc_interleaved(npages * PAGE_SIZE);
+#endif
   if (!base_qnode) {
     abort();
   }
@@ -82,49 +259,66 @@ inline void init_qnodes() {
   // if (ret) {
   //   abort();
   // }
+  nqnode_pools = 1;
+  qnode_pools = new_qnode_pools(1);
+  qnode_pools[0].next_block = 0;
+  qnode_pools[0].nblocks = Lock::kNumQueueNodes / QNODES_PER_THREAD;
+
+#ifdef OMCS_SHARED_MEMORY
+  base_qnode = (QNode *)shm::allocate(sizeof(QNode) * Lock::kNumQueueNodes, alignof(QNode));
+#else
   int node = 0;
   base_qnode = (QNode *)numa_alloc_onnode(sizeof(QNode) * Lock::kNumQueueNodes, node);
+#endif
 
   for (uint32_t i = 0; i < Lock::kNumQueueNodes; ++i) {
     new (base_qnode + i) QNode;
   }
 #endif  // OMCS_OFFSET_NUMA_QNODE
+#ifdef OMCS_SHARED_MEMORY
+  shm::publish(shm::kQNodes, shm::make<shared_qnodes>(shared_qnodes{base_qnode, qnode_pools, nqnode_pools}));
+#endif
 #endif  // OMCS_OFFSET
   return;
 }
 
 #ifdef OMCS_OFFSET
 inline thread_local QNode *qnodes = nullptr;
+inline thread_local thread_qnode_block tls_qnode_block;
 
 inline QNode *get_qnode(size_t i) {
   assert(qnodes);
+  assert(i < QNODES_PER_THREAD);
   new (&qnodes[i]) QNode;
   return &qnodes[i];
 }
+
+#ifdef OMCS_SHARED_MEMORY
+// The block belongs to the parent process: the child takes its own in
+// reset_tls_qnodes()
+inline void forget_tls_qnodes() {
+  tls_qnode_block.socket = thread_qnode_block::kNone;
+  tls_qnode_block.block = thread_qnode_block::kNone;
+  qnodes = nullptr;
+}
+#endif
 #endif
 
+// Must be called by each worker thread before it takes any lock; calling it
+// again keeps the thread's block unless the thread has moved to another socket.
+// The block goes back to the pool when the thread exits, so the thread must not
+// be holding or waiting on any lock at that point.
 inline void reset_tls_qnodes() {
 #ifdef OMCS_OFFSET
-#ifdef BTREE_RWLOCK_MCSRW_ONLY
-  // XXX(shiges): we might need 8-9 qnodes for our workloads
-  constexpr size_t QNODES_PER_THREAD = 16;
-#else
-  // XXX(shiges): grab 4 qnodes every time
-  constexpr size_t QNODES_PER_THREAD = 4;
-#endif
-#ifdef OMCS_OFFSET_NUMA_QNODE
-  uint32_t socket = numa_node_of_cpu(sched_getcpu());
-  uint32_t qnodes_per_page = PAGE_SIZE / sizeof(QNode);
-  uint32_t index = socket_qnode_index[socket].index.fetch_add(QNODES_PER_THREAD);
-
-  uint32_t nsockets = numa_max_node() + 1;
-  uint32_t page_num = index / qnodes_per_page * nsockets + socket;
-  index = page_num * qnodes_per_page + index % qnodes_per_page;
-  qnodes = &offset::base_qnode[index];
-#else
-  uint32_t index = next_node.fetch_add(QNODES_PER_THREAD);
-  qnodes = &offset::base_qnode[index];
-#endif  // OMCS_OFFSET_NUMA_QNODE
+  thread_qnode_block &held = tls_qnode_block;
+  uint32_t socket = current_qnode_pool();
+  if (held.socket != socket) {
+    if (held.socket != thread_qnode_block::kNone) {
+      release_qnode_block(held.socket, held.block);
+    }
+    acquire_qnode_block(socket, held.socket, held.block);
+  }
+  qnodes = &offset::base_qnode[qnode_block_index(held.socket, held.block)];
 #endif
 }
 }  // namespace offset
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <immintrin.h>
+
+#include <atomic>
+#include <cassert>
+#include <type_traits>
+
+#include "OMCSImpl.h"
+
+namespace omcs_impl {
+
+#if !defined(OMCS_OFFSET)
+static_assert(false, "OMCS_OFFSET must be defined for the reader-writer OMCS lock");
+#endif
+#if defined(OMCS_OP_READ)
+static_assert(false, "OMCS_OP_READ is not supported by the reader-writer OMCS lock");
+#endif
+#if defined(OMCS_ABORTABLE)
+static_assert(false, "OMCS_ABORTABLE is not supported by the reader-writer OMCS lock");
+#endif
+#if defined(OMCS_COMBINING)
+static_assert(false, "OMCS_COMBINING is not supported by the reader-writer OMCS lock");
+#endif
+#if defined(OMCS_OBSOLETE_BIT)
+static_assert(false, "OMCS_OBSOLETE_BIT is not supported by the reader-writer OMCS lock");
+#endif
+#if defined(OMCS_WRAPAROUND_GUARD)
+static_assert(false, "OMCS_WRAPAROUND_GUARD is not supported by the reader-writer OMCS lock");
+#endif
+
+// Width of the shared reader count; readers beyond the maximum wait for a slot
+#ifndef OMCS_RW_READER_BITS
+#define OMCS_RW_READER_BITS 7
+#endif
+
+/*
+ * Reader-writer variant of the OMCS lock: optimistic readers, pessimistic
+ * shared readers and queued exclusive writers on one 8-byte lock word,
+ *
+ * |-63-|--62-(63-n)--|--(62-n)-(63-n-r)--|--(62-n-r)-0--|
+ * |mode|queue node id|shared reader count|version number|
+ *
+ * where n = Layout::kQueueNodeIdBits and r = OMCS_RW_READER_BITS. There is
+ * no opportunistic read, which frees bit 62; the rest of the version bits pay
+ * for the reader count, still within OMCS_MIN_WRAPAROUND_DAYS.
+ *
+ * Writers queue up exactly like in BasicOMCSLock, except that they install
+ * themselves with a CAS (keeping the reader count) instead of an exchange.
+ * The head of the queue then waits for the shared readers to drain. Shared
+ * readers do not queue: they bump the reader count while the lock is free of
+ * writers, and otherwise wait for the writer queue to drain, i.e., writers
+ * are preferred.
+ *
+ * Optimistic readers see the version with the reader count masked off, so
+ * they succeed alongside shared readers and are only invalidated by writers.
+ *
+ * As with BasicOMCSLock, a lock is either used with or without queue nodes.
+ * The centralized (qnode-less) API does not wait for shared readers, and
+ * lock() and try_lock() only succeed when there are none.
+ */
+template <class Layout>
+class BasicOMCSRWLock {
+ public:
+  static constexpr uint64_t kQueueNodeIdBits = Layout::kQueueNodeIdBits;
+  static constexpr uint64_t kNumQueueNodes = Layout::kNumQueueNodes;
+  static constexpr uint64_t kReaderBits = OMCS_RW_READER_BITS;
+  static constexpr uint64_t kVersionBits = 63 - kQueueNodeIdBits - kReaderBits;
+
+  static constexpr uint64_t kLockedBit = 1ull << 63;
+  static constexpr uint64_t kVersionMask = (1ull << kVersionBits) - 1;
+  static constexpr uint64_t kReaderShift = kVersionBits;
+  static constexpr uint64_t kReaderIncr = 1ull << kReaderShift;
+  static constexpr uint64_t kMaxReaders = (1ull << kReaderBits) - 1;
+  static constexpr uint64_t kReaderMask = kMaxReaders << kReaderShift;
+  static constexpr uint64_t kQNodeIdShift = kVersionBits + kReaderBits;
+  static constexpr uint64_t kQNodeIdMask = (kNumQueueNodes - 1) << kQNodeIdShift;
+  static constexpr uint64_t kInvalidVersion = OMCSQNode::kNoGrant;
+  static constexpr uint64_t kVersionStride = 1;
+
+  static_assert(kReaderBits > 0 && kQNodeIdShift + kQueueNodeIdBits == 63);
+  static_assert(kVersionMask / Layout::kWraparoundOpsPerSecond >=
+                    OMCS_MIN_WRAPAROUND_DAYS * 24 * 3600,
+                "Too few version bits left next to the shared reader count");
+
+  static inline bool has_locked_bit(const uint64_t val) { return val & kLockedBit; }
+
+  static inline bool is_version(const uint64_t val) { return !has_locked_bit(val); }
+
+  static inline uint64_t reader_count(const uint64_t val) {
+    return (val & kReaderMask) >> kReaderShift;
+  }
+
+  static inline OMCSQNode *get_qnode_ptr(uint64_t val) {
+    assert(has_locked_bit(val));
+    return base_qnode + ((val & kQNodeIdMask) >> kQNodeIdShift);
+  }
+
+  static inline uint64_t make_qnode_ptr(OMCSQNode *const ptr) {
+    return (static_cast<uint64_t>(ptr - base_qnode) << kQNodeIdShift) | kLockedBit;
+  }
+
+  static inline uint64_t make_locked_version(const uint64_t v) {
+    assert(!has_locked_bit(v));
+    return v | kLockedBit;
+  }
+
+  static inline uint64_t next_version(const uint64_t v) {
+    uint64_t next = (v + kVersionStride) & kVersionMask;
+    return next == kInvalidVersion ? kVersionStride : next;
+  }
+
+ private:
+  std::atomic<uint64_t> word_{0};
+
+  // Waits until no shared reader is left; new ones cannot get in as long as
+  // the lock bit is set
+  inline void wait_for_readers() const {
+    while (word_.load(std::memory_order_acquire) & kReaderMask) {
+      _mm_pause();
+    }
+  }
+
+ public:
+  BasicOMCSRWLock() = default;
+
+  BasicOMCSRWLock(const BasicOMCSRWLock &) = delete;
+  BasicOMCSRWLock &operator=(const BasicOMCSRWLock &) = delete;
+
+  uint64_t lock() {
+    uint32_t cas_failure = 0;
+    while (true) {
+      uint64_t version = word_.load(std::memory_order_acquire);
+      if (has_locked_bit(version) || (version & kReaderMask)) {
+        _mm_pause();
+        continue;
+      }
+
+      uint64_t curr = version;
+      if (word_.compare_exchange_strong(curr, make_locked_version(version))) {
+        return version;
+      }
+      backoff::pause(++cas_failure);
+    }
+  }
+
+  bool try_lock(uint64_t version) {
+    // [version] has no readers in it: fails if there are any now
+    uint64_t curr = version;
+    return !has_locked_bit(version) &&
+           word_.compare_exchange_strong(curr, make_locked_version(version));
+  }
+
+  void unlock() {
+    // Only the holder writes to a locked lock word without queue nodes
+    uint64_t v = word_.load(std::memory_order_relaxed);
+    assert(has_locked_bit(v));
+    word_.store(next_version(v & kVersionMask), std::memory_order_release);
+  }
+
+  void unlock(uint64_t v) {
+    (void)v;
+    unlock();
+  }
+
+  void read_lock() {
+    while (true) {
+      uint64_t v = word_.load(std::memory_order_acquire);
+      if (has_locked_bit(v) || reader_count(v) == kMaxReaders) {
+        _mm_pause();
+        continue;
+      }
+      if (word_.compare_exchange_weak(v, v + kReaderIncr)) {
+        return;
+      }
+    }
+  }
+
+  void read_unlock() {
+    assert(reader_count(word_.load()) > 0);
+    word_.fetch_sub(kReaderIncr);
+  }
+
+  // There is no opportunistic read, so the caller never gets to read under a
+  // predecessor's lock
+  inline bool lock_begin(OMCSQNode *qnode) {
+    lock(qnode);
+    return false;
+  }
+
+  inline void lock_turn_off_opread() {}
+
+  inline void lock(OMCSQNode *qnode) { lock(qnode, nullptr); }
+
+  template <class Callback>
+  inline void lock(OMCSQNode *qnode, Callback &&cb) {
+    assert(qnode != nullptr);
+
+#ifndef NDEBUG
+    qnode->set_omcs(this);
+#endif
+
+    qnode->prepare_wait();
+    uint64_t self = make_qnode_ptr(qnode);
+    uint64_t prev = word_.load(std::memory_order_acquire);
+    while (!word_.compare_exchange_weak(prev, self | (prev & kReaderMask))) {
+    }
+
+    if (is_version(prev)) {
+      qnode->set_version(next_version(prev & kVersionMask));
+      wait_for_readers();
+    } else {
+      // Our predecessor has already waited for the readers
+      OMCSQNode *pred = get_qnode_ptr(prev);
+      pred->set_next(qnode);
+      qnode->wait_for_grant();
+    }
+
+    if constexpr (std::is_invocable_v<Callback>) {
+      cb();
+    }
+  }
+
+  inline bool try_lock(OMCSQNode *qnode, uint64_t version) {
+    assert(qnode != nullptr);
+
+#ifndef NDEBUG
+    qnode->set_omcs(this);
+#endif
+
+    qnode->set_next(nullptr);
+    qnode->set_version(next_version(version));
+
+    uint64_t curr = version;
+    return !has_locked_bit(version) && word_.compare_exchange_strong(curr, make_qnode_ptr(qnode));
+  }
+
+  void unlock(OMCSQNode *qnode) {
+    assert(qnode != nullptr);
+
+#ifndef NDEBUG
+    qnode->assert_omcs(this);
+#endif
+
+    uint64_t v0 = qnode->get_version();
+    OMCSQNode *succ = qnode->get_next();
+    if (succ == nullptr) {
+      // No shared readers while we hold the lock
+      uint64_t self = make_qnode_ptr(qnode);
+      if (word_.compare_exchange_strong(self, v0)) {
+        return;
+      }
+
+      do {
+        succ = qnode->get_next();
+      } while (succ == nullptr);
+    }
+
+    succ->grant(next_version(v0));
+  }
+
+  uint64_t begin_read() const {
+    while (true) {
+      bool restart = false;
+      uint64_t version = try_begin_read(restart);
+      if (!restart) {
+        return version;
+      }
+    }
+  }
+
+  uint64_t try_begin_read(bool &restart) const {
+    uint64_t version = word_.load(std::memory_order_acquire);
+    restart = has_locked_bit(version);
+    return version & ~kReaderMask;
+  }
+
+  bool validate_read(uint64_t version) const {
+    assert(!has_locked_bit(version));
+    uint64_t v = word_.load(std::memory_order_acquire);
+    return version == (v & ~kReaderMask);
+  }
+
+  bool is_locked() const {
+    uint64_t version = word_.load(std::memory_order_acquire);
+    return has_locked_bit(version);
+  }
+};
+
+using OMCSRWLock = BasicOMCSRWLock<OMCSDefaultLayout>;
+
+}  // namespace omcs_impl
@@ -9,6 +9,7 @@
 #endif
 #include "latches/OMCSOffset.h"
 #include "third_party/art_ebr/Epoche.h"
+#include "common/perf_counters.h"
 #include "tree_api.hpp"
 
 class artolc_wrapper : public tree_api {
@@ -60,6 +61,11 @@ artolc_wrapper::artolc_wrapper(const tree_options_t &opt) {
 }
 
 artolc_wrapper::~artolc_wrapper() {
+#ifdef PERF_COUNTERS
+  uint64_t operations = 0;
+  auto counts = perf_counters::sum(&operations);
+  perf_counters::print(counts, operations);
+#endif
   // delete tree;
 }
 
@@ -82,6 +88,7 @@ bool artolc_wrapper::bulk_load(const char *data, size_t num_records, size_t key_
 }
 
 bool artolc_wrapper::find(const char *key, size_t key_sz, char *value_out) {
+  PERF_COUNTERS_OPERATION();
   Key tkey;
   tkey.set(key, key_sz);
   auto tid = tree->lookup(tkey);
@@ -97,6 +104,7 @@ bool artolc_wrapper::find(const char *key, size_t key_sz, char *value_out) {
 }
 
 bool artolc_wrapper::insert(const char *key, size_t key_sz, const char *value, size_t value_sz) {
+  PERF_COUNTERS_OPERATION();
   auto tid = makeRecord(key, key_sz, value, value_sz);
 
   Key tkey;
@@ -106,6 +114,7 @@ bool artolc_wrapper::insert(const char *key, size_t key_sz, const char *value, s
 }
 
 bool artolc_wrapper::update(const char *key, size_t key_sz, const char *value, size_t value_sz) {
+  PERF_COUNTERS_OPERATION();
 #if defined(ART_IN_PLACE_UPDATE) || defined(ART_NO_UPDATE)
   static_assert(false, "Not supported");
   Key tkey;
@@ -131,6 +140,7 @@ bool artolc_wrapper::update(const char *key, size_t key_sz, const char *value, s
 }
 
 bool artolc_wrapper::remove(const char *key, size_t key_sz) {
+  PERF_COUNTERS_OPERATION();
   Key tkey;
   tkey.set(key, key_sz);
   auto tid = tree->lookup(tkey);
@@ -143,6 +153,7 @@ bool artolc_wrapper::remove(const char *key, size_t key_sz) {
 }
 
 int artolc_wrapper::scan(const char *key, size_t key_sz, int scan_sz, char *&values_out) {
+  PERF_COUNTERS_OPERATION();
   // XXX(shiges): buffer size
   static thread_local TID results[1024];
   static thread_local char buffer[8192];
@@ -166,4 +177,5 @@ int artolc_wrapper::scan(const char *key, size_t key_sz, int scan_sz, char *&val
 void artolc_wrapper::tls_setup() {
   // XXX(shiges): hack
   offset::reset_tls_qnodes();
+  PERF_COUNTERS_START_THREAD();
 }
@@ -28,6 +28,7 @@ using BTree = btreeolc::BTreeOLCHybrid<uint64_t, uint64_t>;
 #error "BTree synchronization implementation is not defined."
 #endif
 
+#include "common/perf_counters.h"
 #include "tree_api.hpp"
 
 class btreeolc_wrapper : public tree_api {
@@ -52,10 +53,25 @@ class btreeolc_wrapper : public tree_api {
 
 btreeolc_wrapper::btreeolc_wrapper(const tree_options_t &opt) {
   offset::init_qnodes();
+#if defined(LOCK_STATS) && !defined(BTREE_OLC_HYBRID)
+  lock_stats::overflow_group = BTree::lockStatsLevel;
+#endif
   tree = new BTree();
 }
 
-btreeolc_wrapper::~btreeolc_wrapper() { delete tree; }
+btreeolc_wrapper::~btreeolc_wrapper() {
+#if defined(LOCK_STATS) && !defined(BTREE_OLC_HYBRID)
+  lock_stats::print(BTree::lockStatsPerLevel(), "level");
+  // Part of the above counted apart from the per-lock tables
+  lock_stats::print(lock_stats::overflowed(), "overflowed_level");
+#endif
+#ifdef PERF_COUNTERS
+  uint64_t operations = 0;
+  auto counts = perf_counters::sum(&operations);
+  perf_counters::print(counts, operations);
+#endif
+  delete tree;
+}
 
 bool btreeolc_wrapper::bulk_load(const char *data, size_t num_records, size_t key_sz,
                                  size_t value_sz) {
@@ -77,6 +93,7 @@ bool btreeolc_wrapper::bulk_load(const char *data, size_t num_records, size_t ke
 }
 
 bool btreeolc_wrapper::find(const char *key, size_t key_sz, char *value_out) {
+  PERF_COUNTERS_OPERATION();
   uint64_t ikey = *reinterpret_cast<const uint64_t *>(key);
   ikey = __builtin_bswap64(ikey);
   uint64_t ival = 0;
@@ -86,6 +103,7 @@ bool btreeolc_wrapper::find(const char *key, size_t key_sz, char *value_out) {
 }
 
 bool btreeolc_wrapper::insert(const char *key, size_t key_sz, const char *value, size_t value_sz) {
+  PERF_COUNTERS_OPERATION();
   uint64_t ikey = *reinterpret_cast<const uint64_t *>(key);
   ikey = __builtin_bswap64(ikey);
   uint64_t ival = 0;
@@ -94,6 +112,7 @@ bool btreeolc_wrapper::insert(const char *key, size_t key_sz, const char *value,
 }
 
 bool btreeolc_wrapper::update(const char *key, size_t key_sz, const char *value, size_t value_sz) {
+  PERF_COUNTERS_OPERATION();
   uint64_t ikey = *reinterpret_cast<const uint64_t *>(key);
   ikey = __builtin_bswap64(ikey);
   uint64_t ival = 0;
@@ -102,12 +121,14 @@ bool btreeolc_wrapper::update(const char *key, size_t key_sz, const char *value,
 }
 
 bool btreeolc_wrapper::remove(const char *key, size_t key_sz) {
+  PERF_COUNTERS_OPERATION();
   uint64_t ikey = *reinterpret_cast<const uint64_t *>(key);
   ikey = __builtin_bswap64(ikey);
   return tree->remove(ikey);
 }
 
 int btreeolc_wrapper::scan(const char *key, size_t key_sz, int scan_sz, char *&values_out) {
+  PERF_COUNTERS_OPERATION();
   static thread_local uint64_t buffer[1 << 16];
   values_out = reinterpret_cast<char *>(buffer);
   uint64_t ikey = *reinterpret_cast<const uint64_t *>(key);
@@ -118,4 +139,5 @@ int btreeolc_wrapper::scan(const char *key, size_t key_sz, int scan_sz, char *&v
 void btreeolc_wrapper::tls_setup() {
   // XXX(shiges): hack
   offset::reset_tls_qnodes();
+  PERF_COUNTERS_START_THREAD();
 }
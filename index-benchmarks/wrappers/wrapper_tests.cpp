@@ -36,6 +36,7 @@ TYPED_TEST(WrapperTest, InsertThenSearch) {
           --barrier1;
           while (barrier1 > 0) {
           }
+          tree->tls_setup();
           for (uint64_t k = 0; k < kNumKeys; ++k) {
             if (k % kNumThreads == tid) {
               uint64_t key = __builtin_bswap64(k);
@@ -60,6 +61,7 @@ TYPED_TEST(WrapperTest, InsertThenSearch) {
           --barrier2;
           while (barrier2 > 0) {
           }
+          tree->tls_setup();
           for (uint64_t k = 0; k < kNumKeys; ++k) {
             uint64_t key = __builtin_bswap64(k);
             uint64_t value = ~0ull;
@@ -80,6 +82,182 @@ TYPED_TEST(WrapperTest, InsertThenSearch) {
   delete tree;
 }
 
+// Short-lived threads must return their queue nodes, otherwise we would run
+// out of qnode ids long before all threads have run.
+TYPED_TEST(WrapperTest, ThreadChurn) {
+  static constexpr uint64_t kNumRounds = 2048;
+  tree_options_t tree_opt;
+  tree_api *tree = new TypeParam(tree_opt);
+
+  for (uint64_t r = 0; r < kNumRounds; ++r) {
+    std::vector<std::thread> threads;
+    for (uint64_t i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back([&, r, i]() {
+        tree->tls_setup();
+        uint64_t k = r * kNumThreads + i;
+        uint64_t key = __builtin_bswap64(k);
+        bool ok = tree->insert(reinterpret_cast<const char *>(&key), 8,
+                               reinterpret_cast<const char *>(&k), 8);
+        ASSERT_TRUE(ok);
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+  }
+
+  tree->tls_setup();
+  for (uint64_t k = 0; k < kNumRounds * kNumThreads; ++k) {
+    uint64_t key = __builtin_bswap64(k);
+    uint64_t value = ~0ull;
+    bool ok = tree->find(reinterpret_cast<const char *>(&key), 8, reinterpret_cast<char *>(&value));
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(value, k);
+  }
+
+  delete tree;
+}
+
+// Searches and scans running alongside inserts and updates must only see
+// whole values and never miss a key that was there all along. Even keys are
+// loaded first; writers insert the odd keys and update the even ones. Values
+// hold their key in the low bits and the writer's round above.
+TYPED_TEST(WrapperTest, ConcurrentReadersAndWriters) {
+  static constexpr uint64_t kNumWriters = kNumThreads / 2;
+  static constexpr uint64_t kKeyBits = 32;
+  static constexpr uint64_t kKeyMask = (1ull << kKeyBits) - 1;
+  static constexpr int kScanSize = 32;
+  tree_options_t tree_opt;
+  tree_api *tree = new TypeParam(tree_opt);
+
+  tree->tls_setup();
+  for (uint64_t k = 0; k < kNumKeys; k += 2) {
+    uint64_t key = __builtin_bswap64(k);
+    ASSERT_TRUE(tree->insert(reinterpret_cast<const char *>(&key), 8,
+                             reinterpret_cast<const char *>(&k), 8));
+  }
+
+  std::atomic<uint64_t> writers_left(kNumWriters);
+  std::vector<std::thread> threads;
+  for (uint64_t i = 0; i < kNumWriters; ++i) {
+    threads.emplace_back([&, i]() {
+      tree->tls_setup();
+      for (uint64_t k = 2 * i; k < kNumKeys; k += 2 * kNumWriters) {
+        uint64_t key = __builtin_bswap64(k + 1);
+        uint64_t value = k + 1;
+        ASSERT_TRUE(tree->insert(reinterpret_cast<const char *>(&key), 8,
+                                 reinterpret_cast<const char *>(&value), 8));
+        key = __builtin_bswap64(k);
+        value = k | (k << kKeyBits);
+        ASSERT_TRUE(tree->update(reinterpret_cast<const char *>(&key), 8,
+                                 reinterpret_cast<const char *>(&value), 8));
+      }
+      --writers_left;
+    });
+  }
+  for (uint64_t i = kNumWriters; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      tree->tls_setup();
+      for (uint64_t n = i; writers_left > 0; ++n) {
+        uint64_t k = n * 2 % kNumKeys;
+        uint64_t key = __builtin_bswap64(k);
+        uint64_t value = ~0ull;
+        ASSERT_TRUE(tree->find(reinterpret_cast<const char *>(&key), 8,
+                               reinterpret_cast<char *>(&value)));
+        ASSERT_EQ(value & kKeyMask, k);
+
+        // From an even key on, the keys found go up by one, or by two past an
+        // odd key not inserted yet
+        char *values = nullptr;
+        int count = tree->scan(reinterpret_cast<const char *>(&key), 8, kScanSize, values);
+        ASSERT_GT(count, 0);
+        const uint64_t *scanned = reinterpret_cast<const uint64_t *>(values);
+        ASSERT_EQ(scanned[0] & kKeyMask, k);
+        for (int j = 1; j < count; ++j) {
+          uint64_t prev = scanned[j - 1] & kKeyMask;
+          uint64_t next = scanned[j] & kKeyMask;
+          ASSERT_TRUE(next == prev + 1 || (prev % 2 == 0 && next == prev + 2))
+              << "scan from " << k << " found " << next << " after " << prev;
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  for (uint64_t k = 0; k < kNumKeys; ++k) {
+    uint64_t key = __builtin_bswap64(k);
+    uint64_t value = ~0ull;
+    ASSERT_TRUE(tree->find(reinterpret_cast<const char *>(&key), 8,
+                           reinterpret_cast<char *>(&value)));
+    ASSERT_EQ(value, k % 2 ? k : k | (k << kKeyBits));
+  }
+
+  delete tree;
+}
+
+// Updates, removes and inserts that all go to one leaf, as combining latches
+// apply them on behalf of queued writers. Each thread owns two keys of the
+// leaf: one it keeps updating and one it keeps removing and inserting again.
+TYPED_TEST(WrapperTest, HotLeafUpdates) {
+  static constexpr uint64_t kNumOperations = 1000;
+  static constexpr uint64_t kColdKeys = 1ull << 20;
+  tree_options_t tree_opt;
+  tree_api *tree = new TypeParam(tree_opt);
+
+  // The hot leaf is the first of a tree with inner nodes
+  tree->tls_setup();
+  for (uint64_t k = 0; k < 2 * kNumThreads; ++k) {
+    uint64_t key = __builtin_bswap64(k);
+    ASSERT_TRUE(tree->insert(reinterpret_cast<const char *>(&key), 8,
+                             reinterpret_cast<const char *>(&k), 8));
+  }
+  for (uint64_t k = kColdKeys; k < kColdKeys + kNumKeys; ++k) {
+    uint64_t key = __builtin_bswap64(k);
+    ASSERT_TRUE(tree->insert(reinterpret_cast<const char *>(&key), 8,
+                             reinterpret_cast<const char *>(&k), 8));
+  }
+
+  std::vector<std::thread> threads;
+  for (uint64_t i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      tree->tls_setup();
+      uint64_t updated = __builtin_bswap64(2 * i);
+      uint64_t reinserted = __builtin_bswap64(2 * i + 1);
+      for (uint64_t n = 1; n <= kNumOperations; ++n) {
+        uint64_t value = (n << 32) | (2 * i);
+        ASSERT_TRUE(tree->update(reinterpret_cast<const char *>(&updated), 8,
+                                 reinterpret_cast<const char *>(&value), 8));
+        value = (n << 32) | (2 * i + 1);
+        ASSERT_TRUE(tree->remove(reinterpret_cast<const char *>(&reinserted), 8));
+        ASSERT_TRUE(tree->insert(reinterpret_cast<const char *>(&reinserted), 8,
+                                 reinterpret_cast<const char *>(&value), 8));
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  for (uint64_t k = 0; k < 2 * kNumThreads; ++k) {
+    uint64_t key = __builtin_bswap64(k);
+    uint64_t value = ~0ull;
+    ASSERT_TRUE(tree->find(reinterpret_cast<const char *>(&key), 8,
+                           reinterpret_cast<char *>(&value)));
+    ASSERT_EQ(value, (kNumOperations << 32) | k);
+  }
+  for (uint64_t k = kColdKeys; k < kColdKeys + kNumKeys; ++k) {
+    uint64_t key = __builtin_bswap64(k);
+    uint64_t value = ~0ull;
+    ASSERT_TRUE(tree->find(reinterpret_cast<const char *>(&key), 8,
+                           reinterpret_cast<char *>(&value)));
+    ASSERT_EQ(value, k);
+  }
+
+  delete tree;
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
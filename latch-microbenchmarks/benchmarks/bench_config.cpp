@@ -5,10 +5,17 @@
 #include "latches/MCS.h"
 #include "latches/TATAS.h"
 #include "latches/OMCSImpl.h"
+#if defined(OMCS_COHORT)
+#include "latches/OMCSCohort.h"
+#endif
 #if defined(MCSRW_LOCK_ONLY)
 #include "latches/MCSRW.h"
 #endif
 #include "latches/STDRW.h"
+#include "latches/CLH.h"
+#include "latches/Ticket.h"
+#include "latches/HMCS.h"
+#include "latches/ShflLock.h"
 #include "bench_config.hpp"
 #include "distribution.hpp"
 #include "common/delay.h"
@@ -25,19 +32,61 @@ DEFINE_uint64(acq_rel_pct, 20, "Latch acq/rel percentage");
 // Distribution
 DEFINE_string(dist, "fixed", "Latch array indexes distribution");
 DEFINE_validator(dist, ValidateDistribution);
+DEFINE_double(skew, 0.99,
+              "Skew of the zipfian (theta), selfsimilar (h) and hotspot (hot fraction h) "
+              "distributions (default: 0.2 for selfsimilar, whose h must be in (0, 0.5])");
+DEFINE_uint64(hotspot_period_ms, 1000,
+              "Milliseconds before the hotspot distribution moves the hot set (0: never)");
 
 // Critical/parallel section cycles
 DEFINE_uint64(cs_cycles, 1000, "Critical section cycles");
 DEFINE_uint64(ps_cycles, 200000, "Parallel section cycles");
 
+static bool ValidateCriticalSectionMode(const char *flagname, const std::string &value) {
+  if (value == "delay" || value == "read" || value == "write") {
+    return true;
+  }
+  printf("Unknown critical section mode %s\n", value.c_str());
+  return false;
+}
+
+DEFINE_string(cs_mode, "delay",
+              "Critical section: delay (spin only), read (read the latch's payload) or "
+              "write (exclusive holders write the payload, others read it)");
+DEFINE_validator(cs_mode, ValidateCriticalSectionMode);
+DEFINE_uint64(payload_lines, 1, "Cache lines of payload per latch with --cs_mode=read/write");
+
+// Lock coupling
+DEFINE_uint64(depth, 1,
+              "Levels of latches each operation couples from the root down to one of the "
+              "--array_size leaves (1: one latch per operation)");
+DEFINE_uint64(fanout, 16, "Children per inner latch with --depth > 1");
+
+// Sweep in one process, reusing the latches and threads
+DEFINE_string(sweep_threads, "", "Comma-separated thread counts to sweep (default: --threads)");
+DEFINE_string(sweep_cs_cycles, "",
+              "Comma-separated critical section cycles to sweep (default: --cs_cycles)");
+DEFINE_string(sweep_mixes, "",
+              "Comma-separated version-read:acquire-release percentages to sweep, e.g., "
+              "80:20,0:100 (default: --ver_read_pct:--acq_rel_pct)");
+
+// Workload changes during a run
+DEFINE_string(phases, "",
+              "Semicolon-separated workload phases, each ms since the start:key=value,... with "
+              "keys mix (read:write percentages), dist, skew and threads (active threads), "
+              "e.g., 2000:mix=0:100,dist=zipfian;4000:threads=2");
+
+// Reporting
+DEFINE_uint64(handoff_stats, 0, "Measure latch handoff latency (0: off, 1: on)");
+
 template<class Latch>
 void Bench<Latch>::Load() {
   if (FLAGS_ver_read_pct + FLAGS_acq_rel_pct != 100) {
     LOG(FATAL) << "Operation mix doesn't sum up to 100%!";
   }
-  std::cout << "Initiating " << FLAGS_array_size << " latches...";
+  std::cout << "Initiating " << nlatches << " latches...";
 
-  size_t array_size = CACHELINE_SIZE * 2 * FLAGS_array_size;
+  size_t array_size = latch_stride * nlatches;
   int N = 1;
   if (distribution == Distribution::FIXED) {
     N = numa_max_node() + 1;
@@ -45,7 +94,7 @@ void Bench<Latch>::Load() {
   for (int n = 0; n < N; ++n) {
     space[n] = (char *)numa_alloc_onnode(array_size, n);
     memset(space[n], 0, array_size);
-    for (size_t i = 0; i < FLAGS_array_size; ++i) {
+    for (size_t i = 0; i < nlatches; ++i) {
       new (GetLatch(n, i)) Latch();
     }
   }
@@ -53,11 +102,297 @@ void Bench<Latch>::Load() {
   std::cout << "Done" << std::endl;
 }
 
+// Splits a comma-separated list, or returns [fallback] for an empty one
+static std::vector<std::string> SplitList(const std::string &list, const std::string &fallback) {
+  std::vector<std::string> items;
+  std::stringstream ss(list.empty() ? fallback : list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+static Distribution ParseDistribution(std::string dist, double skew) {
+  std::transform(dist.begin(), dist.end(), dist.begin(), ::tolower);
+  if (dist == "fixed") {
+    return Distribution::FIXED;
+  } else if (dist == "uniform") {
+    return Distribution::UNIFORM;
+  } else if (dist == "zipfian") {
+    LOG_IF(FATAL, skew < 0 || skew >= 1) << "zipfian skew must be in [0, 1)";
+    return Distribution::ZIPFIAN;
+  } else if (dist == "selfsimilar") {
+    LOG_IF(FATAL, skew <= 0 || skew > 0.5) << "selfsimilar skew must be in (0, 0.5]";
+    return Distribution::SELFSIMILAR;
+  } else if (dist == "hotspot") {
+    LOG_IF(FATAL, skew <= 0 || skew >= 1) << "hotspot skew must be in (0, 1)";
+    return Distribution::HOTSPOT;
+  }
+  LOG(FATAL) << "unknown distribution";
+  return Distribution::UNIFORM;
+}
+
+// Skew of [dist] when none is given: the --skew default, which is out of
+// selfsimilar's range
+static double DefaultSkew(std::string dist) {
+  std::transform(dist.begin(), dist.end(), dist.begin(), ::tolower);
+  return dist == "selfsimilar" ? 0.2 : 0.99;
+}
+
+static bool SkewIsSet() {
+  gflags::CommandLineFlagInfo flag;
+  return gflags::GetCommandLineFlagInfo("skew", &flag) && !flag.is_default;
+}
+
+template<class Latch>
+void Bench<Latch>::BuildPhases() {
+  phases.clear();
+  Phase phase{0, FLAGS_ver_read_pct, FLAGS_acq_rel_pct, distribution, FLAGS_skew,
+              (uint32_t)FLAGS_threads, IndexGenerator()};
+  std::string dist = FLAGS_dist;
+  bool skew_set = SkewIsSet();
+  std::stringstream ss(FLAGS_phases);
+  std::string spec;
+  while (true) {
+    phase.threads = std::min<uint32_t>(phase.threads, FLAGS_threads);
+    phase.index_generator = IndexGenerator();
+    if (phase.distribution != Distribution::FIXED &&
+        phase.distribution != Distribution::UNIFORM) {
+      phase.index_generator = IndexGenerator(phase.distribution, FLAGS_array_size, phase.skew,
+                                             FLAGS_hotspot_period_ms);
+    }
+    phases.push_back(phase);
+
+    // Next phase: start_ms:key=value,...
+    do {
+      if (!std::getline(ss, spec, ';')) {
+        return;
+      }
+    } while (spec.empty());
+    size_t colon = spec.find(':');
+    LOG_IF(FATAL, colon == std::string::npos) << "Phase " << spec << " has no start time";
+    uint64_t start_ms = std::stoull(spec.substr(0, colon));
+    LOG_IF(FATAL, start_ms <= phase.start_ms || start_ms >= FLAGS_seconds * 1000)
+        << "Phase " << spec << " must start after the previous one and before the end";
+    phase.start_ms = start_ms;
+    for (auto &setting : SplitList(spec.substr(colon + 1), "")) {
+      size_t eq = setting.find('=');
+      std::string key = setting.substr(0, eq);
+      std::string value = eq == std::string::npos ? "" : setting.substr(eq + 1);
+      if (key == "mix") {
+        LOG_IF(FATAL, sscanf(value.c_str(), "%lu:%lu", &phase.ver_read_pct,
+                             &phase.acq_rel_pct) != 2 ||
+                          phase.ver_read_pct + phase.acq_rel_pct != 100)
+            << "Operation mix " << value << " doesn't sum up to 100%!";
+      } else if (key == "dist") {
+        dist = value;
+      } else if (key == "skew") {
+        phase.skew = std::stod(value);
+        skew_set = true;
+      } else if (key == "threads") {
+        phase.threads = std::stoul(value);
+        LOG_IF(FATAL, phase.threads == 0) << "Phase " << spec << " has no active threads";
+      } else {
+        LOG(FATAL) << "Unknown phase setting " << setting;
+      }
+    }
+    if (!skew_set) {
+      phase.skew = DefaultSkew(dist);
+    }
+    phase.distribution = ParseDistribution(dist, phase.skew);
+    // Only the fixed distribution has latches on every NUMA node
+    LOG_IF(FATAL, (phase.distribution == Distribution::FIXED) !=
+                      (distribution == Distribution::FIXED))
+        << "Phases can't switch from or to the fixed distribution";
+  }
+}
+
+template<class Latch>
+void Bench<Latch>::BeginRound(uint32_t round) {
+  const SweepPoint &point = sweep[round];
+  FLAGS_threads = point.threads;
+  FLAGS_cs_cycles = point.cs_cycles;
+  FLAGS_ver_read_pct = point.ver_read_pct;
+  FLAGS_acq_rel_pct = point.acq_rel_pct;
+  if (sweep.size() > 1) {
+    std::cout << "=====================" << std::endl;
+    std::cout << "Round " << round + 1 << "/" << sweep.size() << ": " << point.threads
+              << " threads, " << point.cs_cycles << " cycles critical section, "
+              << point.ver_read_pct << "% version-read, " << point.acq_rel_pct
+              << "% acquire-release" << std::endl;
+  }
+  BuildPhases();
+
+  // Latch stats are per round; workers are parked until the round starts
+  std::lock_guard<std::mutex> guard(handoff_latencies_mutex);
+  for (auto &latencies : handoff_latencies) {
+    *latencies = LatencyHistogram();
+  }
+}
+
 template<class Latch>
-void Bench<Latch>::CriticalSection() {
+std::vector<std::string> Bench<Latch>::ParameterFlags() {
+  std::vector<std::string> flags = PerformanceTest::ParameterFlags();
+  flags.insert(flags.end(), {"threads", "seconds", "array_size", "ver_read_pct", "acq_rel_pct",
+                             "dist", "skew", "hotspot_period_ms", "cs_cycles", "ps_cycles",
+                             "cs_mode", "payload_lines", "depth", "fanout", "sweep_threads",
+                             "sweep_cs_cycles", "sweep_mixes", "phases", "handoff_stats"});
+  return flags;
+}
+
+template<class Latch>
+void Bench<Latch>::ReportLatchStats(std::ostream &json) {
+  if (FLAGS_handoff_stats) {
+    ReportHandoffStats(json);
+  }
+}
+
+template<class Latch>
+void Bench<Latch>::CriticalSection(size_t node, size_t idx, bool exclusive) {
+  if (cs_mode != CriticalSectionMode::DELAY) {
+    uint64_t *payload = GetPayload(node, idx);
+    size_t nwords = FLAGS_payload_lines * CACHELINE_SIZE / sizeof(uint64_t);
+    if (exclusive && cs_mode == CriticalSectionMode::WRITE) {
+      uint64_t value = __atomic_load_n(&payload[0], __ATOMIC_RELAXED) + 1;
+      for (size_t i = 0; i < nwords; ++i) {
+        __atomic_store_n(&payload[i], value, __ATOMIC_RELAXED);
+      }
+    } else {
+      // Racy under an optimistic read, which validates afterwards
+      PayloadCopy &copy = GetPayloadCopy();
+      copy.words.resize(nwords);
+      for (size_t i = 0; i < nwords; ++i) {
+        copy.words[i] = __atomic_load_n(&payload[i], __ATOMIC_RELAXED);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+  }
   Work(FLAGS_cs_cycles);
 }
 
+template<class Latch>
+bool Bench<Latch>::VerifyRead() {
+  if (cs_mode == CriticalSectionMode::DELAY) {
+    return true;
+  }
+  PayloadCopy &copy = GetPayloadCopy();
+  ++copy.verified;
+  for (uint64_t word : copy.words) {
+    if (word != copy.words[0]) {
+      ++copy.torn;
+      return false;
+    }
+  }
+  return true;
+}
+
+template<class Latch>
+bool Bench<Latch>::LatchBeginRead(size_t node, size_t idx, uint64_t &version) {
+  if constexpr (HasOptimisticRead<Latch>::value) {
+    bool restart = false;
+    version = GetLatch(node, idx)->try_begin_read(restart);
+    return !restart;
+  } else {
+    LOG(FATAL) << "Lock coupling is not supported by this latch";
+    return false;
+  }
+}
+
+template<class Latch>
+bool Bench<Latch>::LatchValidateRead(size_t node, size_t idx, uint64_t version) {
+  if constexpr (HasOptimisticRead<Latch>::value) {
+    return GetLatch(node, idx)->validate_read(version);
+  } else {
+    LOG(FATAL) << "Lock coupling is not supported by this latch";
+    return false;
+  }
+}
+
+template<class Latch>
+void Bench<Latch>::LatchLock(size_t node, size_t idx) {
+  LOG(FATAL) << "Lock coupling is not supported by this latch";
+}
+
+template<class Latch>
+void Bench<Latch>::LatchUnlock(size_t node, size_t idx) {
+  LOG(FATAL) << "Lock coupling is not supported by this latch";
+}
+
+template<class Latch>
+size_t Bench<Latch>::AncestorOf(size_t leaf, uint64_t level) {
+  for (uint64_t l = FLAGS_depth - 1; l > level; --l) {
+    leaf /= FLAGS_fanout;
+  }
+  return level_offsets[level] + leaf;
+}
+
+template<class Latch>
+uint64_t Bench<Latch>::LatchTraverse(size_t node, size_t leaf, bool write, bool &done) {
+  uint64_t restarts = 0;
+  done = false;
+  while (!shutdown) {
+    size_t parent = AncestorOf(leaf, 0);
+    uint64_t parent_version = 0;
+    if (!LatchBeginRead(node, parent, parent_version)) {
+      ++restarts;
+      continue;
+    }
+    CriticalSection(node, parent, false);
+
+    bool restart = false;
+    for (uint64_t level = 1; level < FLAGS_depth; ++level) {
+      size_t child = AncestorOf(leaf, level);
+      bool is_leaf = level == FLAGS_depth - 1;
+      uint64_t child_version = 0;
+      if (is_leaf && write) {
+        uint64_t start = FLAGS_handoff_stats ? __rdtsc() : 0;
+        LatchLock(node, child);
+        AfterAcquire(node, child, start);
+        bool valid = LatchValidateRead(node, parent, parent_version);
+        if (valid) {
+          VerifyRead();
+          CriticalSection(node, child, true);
+        }
+        BeforeRelease(node, child);
+        LatchUnlock(node, child);
+        restart = !valid;
+        break;
+      }
+      if (!LatchBeginRead(node, child, child_version) ||
+          !LatchValidateRead(node, parent, parent_version)) {
+        restart = true;
+        break;
+      }
+      VerifyRead();
+      CriticalSection(node, child, false);
+      if (is_leaf) {
+        if (!LatchValidateRead(node, child, child_version)) {
+          restart = true;
+          break;
+        }
+        VerifyRead();
+      }
+      parent = child;
+      parent_version = child_version;
+    }
+    if (!restart) {
+      done = true;
+      break;
+    }
+    ++restarts;
+  }
+  return restarts;
+}
+
+template<class Latch>
+typename Bench<Latch>::PayloadCopy &Bench<Latch>::GetPayloadCopy() {
+  thread_local PayloadCopy copy;
+  return copy;
+}
+
 // Borrowed from asynclib: https://github.com/sfu-dis/omcs-ascylib/blob/3c2d1a231eac3518a4167d7d4a709cb22a3cff6b/include/latency.h
 static inline uint64_t getticks(void) {
   unsigned hi, lo;
@@ -136,34 +471,136 @@ void Bench<Latch>::ParallelSection() {
   Work(FLAGS_ps_cycles);
 }
 
+template<class Latch>
+void Bench<Latch>::BeforeRelease(size_t node, size_t idx) {
+  if (FLAGS_handoff_stats) {
+    GetReleaseTime(node, idx)->store(__rdtsc(), std::memory_order_relaxed);
+  }
+}
+
+template<class Latch>
+void Bench<Latch>::AfterAcquire(size_t node, size_t idx, uint64_t acquire_start) {
+  if (!FLAGS_handoff_stats) {
+    return;
+  }
+  uint64_t now = __rdtsc();
+  uint64_t released = GetReleaseTime(node, idx)->load(std::memory_order_relaxed);
+  if (released <= acquire_start) {
+    // The latch was free when we got there
+    return;
+  }
+  GetHandoffLatencies().Record(now - released);
+}
+
+template<class Latch>
+LatencyHistogram &Bench<Latch>::GetHandoffLatencies() {
+  thread_local LatencyHistogram *latencies = nullptr;
+  if (!latencies) {
+    std::lock_guard<std::mutex> guard(handoff_latencies_mutex);
+    handoff_latencies.emplace_back(new LatencyHistogram);
+    latencies = handoff_latencies.back().get();
+  }
+  return *latencies;
+}
+
+template<class Latch>
+void Bench<Latch>::ReportHandoffStats(std::ostream &json) {
+  LatencyHistogram total;
+  for (auto &latencies : handoff_latencies) {
+    total.Merge(*latencies);
+  }
+
+  std::cout << "=====================" << std::endl;
+  std::cout << "Handoffs,P50,P99,P99.9,Max (cycles): " << std::endl;
+  std::cout << total.count
+            << "," << total.Percentile(50)
+            << "," << total.Percentile(99)
+            << "," << total.Percentile(99.9)
+            << "," << total.max
+            << std::endl;
+
+  json << ", \"handoff_latency_cycles\": ";
+  total.WriteJson(json);
+}
+
 template<class Latch>
 void Bench<Latch>::WorkerRun(uint32_t node_id, uint32_t thread_id) {
   // Do real work until shutdown
   foedus::assorted::UniformRandom rng(thread_id);
+  IndexGenerator index_rng;
+  const Phase *phase = nullptr;
+  uint32_t my_phase = ~0u;
   size_t my_noperations = 0;
   size_t my_nsuccesses = 0;
   size_t my_reads = 0;
   size_t my_read_successes = 0;
+  size_t my_traversals = 0;
+  size_t my_restarts = 0;
+  GetPayloadCopy().verified = 0;
+  GetPayloadCopy().torn = 0;
+  OperationLatencies &my_latencies = *latencies[thread_id];
+  uint64_t sample_countdown = FLAGS_latency_sample_rate;
+  Progress &my_progress = *progress[thread_id];
   while (!shutdown) {
+    uint32_t current = current_phase.load(std::memory_order_acquire);
+    if (current != my_phase) {
+      my_phase = current;
+      phase = &phases[current];
+      index_rng = phase->index_generator;
+      index_rng.Reseed(current * nthreads + thread_id);
+    }
+    if (thread_id >= phase->threads) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+
     bool succeeded = false;
     uint64_t k = rng.uniform_within(0, 99);
     uint64_t node = 0;
     uint64_t idx = 0;
-    if (distribution == Distribution::FIXED) {
+    if (phase->distribution == Distribution::FIXED) {
       node = node_id;
       idx = thread_id;
-    } else if (distribution == Distribution::UNIFORM) {
+    } else if (phase->distribution == Distribution::UNIFORM) {
       idx = rng.uniform_within(0, FLAGS_array_size - 1);
+    } else {
+      idx = index_rng.Next();
     }
-    if (k < FLAGS_ver_read_pct) {
+    bool sampled = FLAGS_latency_sample_rate && --sample_countdown == 0;
+    uint64_t start = sampled ? __rdtsc() : 0;
+    if (FLAGS_depth > 1) {
+      bool write = k >= phase->ver_read_pct;
+      my_restarts += LatchTraverse(node, idx, write, succeeded);
+      if (!write) {
+        ++my_reads;
+        if (succeeded) {
+          ++my_read_successes;
+        }
+      }
+      if (succeeded) {
+        ++my_traversals;
+      }
+      if (sampled) {
+        (write ? my_latencies.acquire_releases : my_latencies.reads).Record(__rdtsc() - start);
+      }
+    } else if (k < phase->ver_read_pct) {
       succeeded = LatchVersionRead(node, idx);
       ++my_reads;
       if (succeeded) {
         ++my_read_successes;
       }
-    } else if (k < FLAGS_ver_read_pct + FLAGS_acq_rel_pct) {
+      if (sampled) {
+        my_latencies.reads.Record(__rdtsc() - start);
+      }
+    } else if (k < phase->ver_read_pct + phase->acq_rel_pct) {
       succeeded = true;
       LatchAcquireRelease(node, idx);
+      if (sampled) {
+        my_latencies.acquire_releases.Record(__rdtsc() - start);
+      }
+    }
+    if (sampled) {
+      sample_countdown = FLAGS_latency_sample_rate;
     }
 
     ParallelSection();
@@ -171,9 +608,16 @@ void Bench<Latch>::WorkerRun(uint32_t node_id, uint32_t thread_id) {
     ++my_noperations;
     if (succeeded) {
       ++my_nsuccesses;
+      if (FLAGS_interval_ms) {
+        my_progress.successes.store(my_nsuccesses, std::memory_order_relaxed);
+      }
     }
   }
   noperations[thread_id] = my_noperations;
+  verified_reads[thread_id] = GetPayloadCopy().verified;
+  torn_reads[thread_id] = GetPayloadCopy().torn;
+  traversals[thread_id] = my_traversals;
+  restarts[thread_id] = my_restarts;
   nsuccesses[thread_id] = my_nsuccesses;
   reads[thread_id] = my_reads;
   read_successes[thread_id] = my_read_successes;
@@ -181,15 +625,48 @@ void Bench<Latch>::WorkerRun(uint32_t node_id, uint32_t thread_id) {
 
 template <class Latch>
 Bench<Latch>::Bench() : PerformanceTest(FLAGS_threads, FLAGS_seconds) {
-  {
-    std::string dist(FLAGS_dist);
-    std::transform(dist.begin(), dist.end(), dist.begin(), ::tolower);
-    if (dist == "fixed") {
-      distribution = Distribution::FIXED;
-    } else if (dist == "uniform") {
-      distribution = Distribution::UNIFORM;
-    } else {
-      LOG(FATAL) << "unknown distribution";
+  if (!SkewIsSet()) {
+    FLAGS_skew = DefaultSkew(FLAGS_dist);
+  }
+  distribution = ParseDistribution(FLAGS_dist, FLAGS_skew);
+  if (FLAGS_cs_mode == "read") {
+    cs_mode = CriticalSectionMode::READ;
+  } else if (FLAGS_cs_mode == "write") {
+    cs_mode = CriticalSectionMode::WRITE;
+  } else {
+    cs_mode = CriticalSectionMode::DELAY;
+  }
+  latch_stride = kLatchSize + CACHELINE_SIZE;
+  if (cs_mode != CriticalSectionMode::DELAY) {
+    latch_stride += CACHELINE_SIZE * FLAGS_payload_lines;
+  }
+  LOG_IF(FATAL, FLAGS_depth == 0) << "depth must be at least 1";
+  LOG_IF(FATAL, FLAGS_depth > 1 && FLAGS_fanout < 2) << "fanout must be at least 2";
+  LOG_IF(FATAL, FLAGS_depth > 1 && !HasOptimisticRead<Latch>::value)
+      << "Lock coupling (--depth > 1) needs a latch with optimistic reads";
+  // Level sizes from the leaves up; a root level with several latches is a
+  // forest of --array_size / fanout^(depth - 1) trees
+  level_offsets.assign(FLAGS_depth, 0);
+  nlatches = FLAGS_array_size;
+  size_t level_size = FLAGS_array_size;
+  for (uint64_t level = FLAGS_depth - 1; level > 0; --level) {
+    level_size = (level_size + FLAGS_fanout - 1) / FLAGS_fanout;
+    level_offsets[level - 1] = nlatches;
+    nlatches += level_size;
+  }
+  for (auto &mix : SplitList(FLAGS_sweep_mixes, std::to_string(FLAGS_ver_read_pct) + ":" +
+                                                    std::to_string(FLAGS_acq_rel_pct))) {
+    uint64_t ver_read_pct = 0;
+    uint64_t acq_rel_pct = 0;
+    LOG_IF(FATAL, sscanf(mix.c_str(), "%lu:%lu", &ver_read_pct, &acq_rel_pct) != 2 ||
+                      ver_read_pct + acq_rel_pct != 100)
+        << "Operation mix " << mix << " doesn't sum up to 100%!";
+    for (auto &cs_cycles : SplitList(FLAGS_sweep_cs_cycles, std::to_string(FLAGS_cs_cycles))) {
+      for (auto &threads : SplitList(FLAGS_sweep_threads, std::to_string(FLAGS_threads))) {
+        LOG_IF(FATAL, std::stoul(threads) == 0) << "Sweeping zero threads";
+        sweep.push_back(SweepPoint{(uint32_t)std::stoul(threads), std::stoull(cs_cycles),
+                                   ver_read_pct, acq_rel_pct});
+      }
     }
   }
 
@@ -202,8 +679,29 @@ Bench<Latch>::Bench() : PerformanceTest(FLAGS_threads, FLAGS_seconds) {
   std::cout << "  acquire-release: " << FLAGS_acq_rel_pct << std::endl;
   std::cout << "Index distribution: " << std::endl;
   std::cout << "  distribution:   " << FLAGS_dist << std::endl;
+  if (distribution != Distribution::FIXED && distribution != Distribution::UNIFORM) {
+    std::cout << "  skew:           " << FLAGS_skew << std::endl;
+  }
+  if (distribution == Distribution::HOTSPOT) {
+    std::cout << "  hotspot period: " << FLAGS_hotspot_period_ms << " ms" << std::endl;
+  }
+  if (FLAGS_depth > 1) {
+    std::cout << "Lock coupling: " << std::endl;
+    std::cout << "  depth:  " << FLAGS_depth << std::endl;
+    std::cout << "  fanout: " << FLAGS_fanout << std::endl;
+  }
   std::cout << "Critical section:   " << FLAGS_cs_cycles << " cycles" << std::endl;
+  if (cs_mode != CriticalSectionMode::DELAY) {
+    std::cout << "  " << FLAGS_cs_mode << " payload: " << FLAGS_payload_lines << " cache lines"
+              << std::endl;
+  }
   std::cout << "Parallel section:   " << FLAGS_ps_cycles << " cycles" << std::endl;
+  if (sweep.size() > 1) {
+    std::cout << "Sweep: " << sweep.size() << " rounds" << std::endl;
+  }
+  if (!FLAGS_phases.empty()) {
+    std::cout << "Phases: " << FLAGS_phases << std::endl;
+  }
 
   Load();
 }
@@ -212,7 +710,14 @@ Bench<Latch>::Bench() : PerformanceTest(FLAGS_threads, FLAGS_seconds) {
 template class Bench<mcs::MCSLock>;
 template class Bench<TATAS>;
 template class Bench<omcs_impl::OMCSLock>;
+#if defined(OMCS_COHORT)
+template class Bench<omcs_impl::OMCSCohortLock>;
+#endif
 #if defined(MCSRW_LOCK_ONLY)
 template class Bench<mcsrw::MCSRWLock>;
 #endif
 template class Bench<std_lock::STDRWLock>;
+template class Bench<clh::CLHLock>;
+template class Bench<ticket::TicketLock>;
+template class Bench<hmcs::HMCSLock>;
+template class Bench<shfl::ShflLock>;
@@ -1,6 +1,14 @@
 #include <x86intrin.h>
 #include <gflags/gflags.h>
+
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include "distribution.hpp"
+#include "latency_histogram.hpp"
 #include "perf.hpp"
 
 DECLARE_uint64(threads);
@@ -9,8 +17,36 @@ DECLARE_uint64(array_size);
 DECLARE_uint64(ver_read_pct);
 DECLARE_uint64(acq_rel_pct);
 DECLARE_string(dist);
+DECLARE_double(skew);
+DECLARE_uint64(hotspot_period_ms);
 DECLARE_uint64(cs_cycles);
 DECLARE_uint64(ps_cycles);
+DECLARE_string(cs_mode);
+DECLARE_uint64(payload_lines);
+DECLARE_uint64(depth);
+DECLARE_uint64(fanout);
+DECLARE_uint64(handoff_stats);
+DECLARE_string(sweep_threads);
+DECLARE_string(sweep_cs_cycles);
+DECLARE_string(sweep_mixes);
+DECLARE_string(phases);
+
+// What critical sections do besides spinning for --cs_cycles
+enum class CriticalSectionMode {
+  DELAY = 0,  // Nothing
+  READ = 1,   // Read the latch's payload
+  WRITE = 2,  // Exclusive holders write the payload, others read it
+};
+
+// Whether [Latch] can be read optimistically: try_begin_read() for a version,
+// validate_read() to check it after the read
+template<class Latch, class = void>
+struct HasOptimisticRead : std::false_type {};
+
+template<class Latch>
+struct HasOptimisticRead<Latch, std::void_t<
+    decltype(std::declval<Latch &>().try_begin_read(std::declval<bool &>())),
+    decltype(std::declval<Latch &>().validate_read(uint64_t{}))>> : std::true_type {};
 
 template<class Latch>
 struct Bench : public PerformanceTest {
@@ -23,8 +59,21 @@ struct Bench : public PerformanceTest {
   // Destructor
   ~Bench() {}
 
+  // Each latch takes the cache lines it needs (one for most, more for latches
+  // that keep queue nodes of their own), followed by a line for handoff stats
+  // and --payload_lines lines of payload with --cs_mode=read/write. With
+  // --depth > 1, the latches of the inner levels follow the --array_size
+  // leaves.
+  static constexpr size_t kLatchSize =
+      (sizeof(Latch) + CACHELINE_SIZE - 1) / CACHELINE_SIZE * CACHELINE_SIZE;
+
   inline Latch *GetLatch(size_t node, size_t idx) {
-    return reinterpret_cast<Latch *>(&space[node][idx * CACHELINE_SIZE * 2]);
+    return reinterpret_cast<Latch *>(&space[node][idx * latch_stride]);
+  }
+
+  inline uint64_t *GetPayload(size_t node, size_t idx) {
+    return reinterpret_cast<uint64_t *>(
+        &space[node][idx * latch_stride + kLatchSize + CACHELINE_SIZE]);
   }
 
   // Version read operation
@@ -33,16 +82,136 @@ struct Bench : public PerformanceTest {
   // Acquire-release operation
   virtual void LatchAcquireRelease(size_t node, size_t idx) = 0;
 
+  // Lock coupling primitives (--depth > 1), only for latches with optimistic
+  // reads: LatchBeginRead() returns false if the latch can't be read now.
+  // Benchmarks provide LatchLock() and LatchUnlock(), which need their queue
+  // nodes.
+  bool LatchBeginRead(size_t node, size_t idx, uint64_t &version);
+  bool LatchValidateRead(size_t node, size_t idx, uint64_t version);
+  virtual void LatchLock(size_t node, size_t idx);
+  virtual void LatchUnlock(size_t node, size_t idx);
+
+  // Walks the --depth levels from the root down to [leaf] like a B+-tree
+  // operation: optimistic reads on inner levels, each validated after reading
+  // the version of its child, and an optimistic read ([write] = false) or an
+  // exclusive lock of the leaf, which counts towards --handoff_stats. Restarts
+  // from the root whenever a latch can't be read or fails validation; returns
+  // the number of restarts, or false through [done] if the benchmark ended
+  // before the traversal did.
+  uint64_t LatchTraverse(size_t node, size_t leaf, bool write, bool &done);
+
+  // Index of [leaf]'s ancestor at [level] (0: root, --depth - 1: the leaf)
+  size_t AncestorOf(size_t leaf, uint64_t level);
+
   void Load();
 
-  void CriticalSection();
+  // Sweep rounds (--sweep_*), all over the latches loaded once
+  uint32_t Rounds() override { return sweep.size(); }
+  uint32_t RoundThreads(uint32_t round) override { return sweep[round].threads; }
+  void BeginRound(uint32_t round) override;
+
+  std::vector<std::string> ParameterFlags() override;
+  void ReportLatchStats(std::ostream &json) override;
+
+  // Workload phases of each round (--phases)
+  uint32_t Phases() override { return phases.size(); }
+  uint64_t PhaseStartMs(uint32_t phase) override { return phases[phase].start_ms; }
+  uint32_t PhaseThreads(uint32_t phase) override { return phases[phase].threads; }
+  void BeginPhase(uint32_t phase) override {
+    current_phase.store(phase, std::memory_order_release);
+  }
+
+  // Critical section of a thread that holds the latch, or reads it
+  // optimistically: spins for --cs_cycles, and with --cs_mode=write an
+  // [exclusive] holder fills every word of the payload with one new value,
+  // while everyone else copies the payload.
+  void CriticalSection(size_t node, size_t idx, bool exclusive);
+
+  // Checks the copy taken by the last non-exclusive CriticalSection(): call it
+  // once an optimistic read validated (or after a shared read), so that reads
+  // that validated but saw a torn payload are counted. Returns false if torn.
+  bool VerifyRead();
 
   void ParallelSection();
 
+  // Handoff latency (--handoff_stats=1): cycles from a holder's release to the
+  // acquire of a thread that was already waiting for the latch. The release
+  // time is kept in the (otherwise unused) cache line after each latch.
+  //
+  // Call BeforeRelease() right before releasing a latch, and AfterAcquire()
+  // right after acquiring it with the time the acquire started.
+  void BeforeRelease(size_t node, size_t idx);
+  void AfterAcquire(size_t node, size_t idx, uint64_t acquire_start);
+
+  // Prints handoff latency percentiles of the round, and adds them to [json]
+  void ReportHandoffStats(std::ostream &json);
+
   Distribution distribution;
 
+  CriticalSectionMode cs_mode;
+
+  // Bytes from one latch to the next
+  size_t latch_stride;
+
+  // Latches per NUMA node, and where each level of the hierarchy starts
+  // (--depth > 1)
+  size_t nlatches;
+  std::vector<size_t> level_offsets;
+
+  // Workload of the current round from each start time on: --phases on top of
+  // the round's operation mix, --dist, --skew and threads. Each phase keeps
+  // the settings of the previous one it doesn't change.
+  struct Phase {
+    uint64_t start_ms;
+    uint64_t ver_read_pct;
+    uint64_t acq_rel_pct;
+    Distribution distribution;
+    double skew;
+    uint32_t threads;  // Active threads; the others sleep
+
+    // Prototype of the per-thread latch index generators (skewed distributions)
+    IndexGenerator index_generator;
+  };
+  std::vector<Phase> phases;
+
+  // Parses --phases into [phases] for the current round
+  void BuildPhases();
+
+  // Index into [phases] that workers follow
+  CACHE_ALIGNED std::atomic<uint32_t> current_phase{0};
+
+  // Configurations to benchmark, one per round: the thread counts x critical
+  // section lengths x operation mixes of --sweep_*, or just --threads,
+  // --cs_cycles and the mix without a sweep
+  struct SweepPoint {
+    uint32_t threads;
+    uint64_t cs_cycles;
+    uint64_t ver_read_pct;
+    uint64_t acq_rel_pct;
+  };
+  std::vector<SweepPoint> sweep;
+
  private:
   void Work(int64_t cycles);
 
+  // Handoff latencies of the calling worker thread
+  LatencyHistogram &GetHandoffLatencies();
+
+  // Payload copied by the calling thread, and its verified and torn reads
+  struct PayloadCopy {
+    std::vector<uint64_t> words;
+    uint64_t verified = 0;
+    uint64_t torn = 0;
+  };
+
+  PayloadCopy &GetPayloadCopy();
+
+  inline std::atomic<uint64_t> *GetReleaseTime(size_t node, size_t idx) {
+    return reinterpret_cast<std::atomic<uint64_t> *>(&space[node][idx * latch_stride + kLatchSize]);
+  }
+
   char *space[8] CACHE_ALIGNED;
+
+  std::mutex handoff_latencies_mutex;
+  std::vector<std::unique_ptr<LatencyHistogram>> handoff_latencies;
 };
@@ -0,0 +1,34 @@
+#include "bench_config.hpp"
+#include "clh_bench.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+bool CLHBench::LatchVersionRead(size_t node, size_t idx) {
+  Latch *latch = GetLatch(node, idx);
+  return false;
+}
+
+void CLHBench::LatchAcquireRelease(size_t node, size_t idx) {
+  Latch *latch = GetLatch(node, idx);
+  // Queue nodes migrate between threads: each unlock() hands back another one
+  thread_local QNode *q = new QNode;
+
+  uint64_t start = FLAGS_handoff_stats ? __rdtsc() : 0;
+  latch->lock(q);
+  AfterAcquire(node, idx, start);
+  CriticalSection(node, idx, true);
+  BeforeRelease(node, idx);
+  q = latch->unlock(q);
+}
+
+int main(int argc, char **argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  CLHBench test;
+  test.Run();
+
+  return 0;
+}
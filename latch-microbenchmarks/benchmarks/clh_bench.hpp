@@ -0,0 +1,21 @@
+#pragma once
+
+#include "latches/CLH.h"
+#include "perf.hpp"
+
+struct CLHBench : public Bench<clh::CLHLock> {
+  using Latch = clh::CLHLock;
+  using QNode = clh::CLHQNode;
+
+  // Constructor
+  CLHBench() : Bench<clh::CLHLock>() {}
+
+  // Destructor
+  ~CLHBench() {}
+
+  // Version read operation
+  bool LatchVersionRead(size_t node, size_t idx) override;
+
+  // Acquire-release operation
+  void LatchAcquireRelease(size_t node, size_t idx) override;
+};
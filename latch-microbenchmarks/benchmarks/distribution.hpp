@@ -1,19 +1,106 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <string>
 
+#include "third_party/foedus/uniform_random.hpp"
+#include "third_party/foedus/zipfian_random.hpp"
+
 enum class Distribution {
   FIXED = 0,
   UNIFORM = 1,
+  ZIPFIAN = 2,
+  SELFSIMILAR = 3,
+  HOTSPOT = 4,
 };
 
 inline static bool ValidateDistribution(const char *flagname, const std::string &value) {
   std::string dist(value);
   std::transform(dist.begin(), dist.end(), dist.begin(), ::tolower);
-  if (dist == "fixed" || dist == "uniform") {
+  if (dist == "fixed" || dist == "uniform" || dist == "zipfian" || dist == "selfsimilar" ||
+      dist == "hotspot") {
     return true;
   }
   printf("Unknown distribution %s\n", value.c_str());
   return false;
 }
+
+// Per-thread generator of latch indexes under the skewed distributions; the
+// skew parameter means
+//
+//   zipfian:     theta in [0, 1), latch i is picked with probability ~ 1/(i+1)^theta
+//   selfsimilar: h in (0, 0.5], a fraction 1-h of the picks go to the first h
+//                of the latches, recursively (h = 0.2 gives 80-20)
+//   hotspot:     h in (0, 1), a fraction 1-h of the picks go to a hot set of
+//                h of the latches, which moves to the next h of the latches
+//                every [hotspot_period_ms] (never if 0)
+//
+// Construct one prototype per benchmark and copy it into each thread with
+// Reseed(): computing the zipfian constants takes O(array size).
+class IndexGenerator {
+ public:
+  IndexGenerator() {}
+
+  IndexGenerator(Distribution distribution, uint64_t items, double skew,
+                 uint64_t hotspot_period_ms)
+      : distribution_(distribution),
+        items_(items),
+        skew_(skew),
+        hot_items_(std::min<uint64_t>(items, std::max<uint64_t>(1, items * skew))),
+        hotspot_period_(std::chrono::milliseconds(hotspot_period_ms)),
+        start_(std::chrono::steady_clock::now()) {
+    if (distribution == Distribution::ZIPFIAN && items > 1) {
+      zipf_.init(items, skew, 0);
+    }
+    if (distribution == Distribution::SELFSIMILAR) {
+      exponent_ = std::log(skew) / std::log(1 - skew);
+    }
+  }
+
+  void Reseed(uint64_t seed) {
+    rng_.set_current_seed(seed);
+    zipf_.set_current_seed(seed);
+  }
+
+  uint64_t Next() {
+    switch (distribution_) {
+      case Distribution::ZIPFIAN:
+        return items_ > 1 ? std::min(zipf_.next(), items_ - 1) : 0;
+      case Distribution::SELFSIMILAR: {
+        double u = rng_.next_uint32() / 4294967296.0;
+        return std::min<uint64_t>(items_ * std::pow(u, exponent_), items_ - 1);
+      }
+      case Distribution::HOTSPOT: {
+        // Reading the clock every pick would cost as much as a short critical
+        // section
+        if (hotspot_period_.count() && picks_++ % kPicksPerClockCheck == 0) {
+          hot_start_ = (std::chrono::steady_clock::now() - start_) / hotspot_period_ *
+                       hot_items_ % items_;
+        }
+        bool hot = hot_items_ == items_ || rng_.uniform_within(0, 9999) >= skew_ * 10000;
+        uint64_t offset = hot ? rng_.uniform_within(0, hot_items_ - 1)
+                              : hot_items_ + rng_.uniform_within(0, items_ - hot_items_ - 1);
+        return (hot_start_ + offset) % items_;
+      }
+      default:
+        return rng_.uniform_within(0, items_ - 1);
+    }
+  }
+
+ private:
+  static constexpr uint64_t kPicksPerClockCheck = 256;
+
+  Distribution distribution_ = Distribution::UNIFORM;
+  uint64_t items_ = 1;
+  double skew_ = 0;
+  double exponent_ = 1;
+  uint64_t hot_items_ = 1;
+  uint64_t hot_start_ = 0;
+  uint64_t picks_ = 0;
+  std::chrono::steady_clock::duration hotspot_period_;
+  std::chrono::steady_clock::time_point start_;
+  foedus::assorted::UniformRandom rng_;
+  foedus::assorted::ZipfianRandom zipf_;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "latches/HMCS.h"
+#include "perf.hpp"
+
+struct HMCSBench : public Bench<hmcs::HMCSLock> {
+  using Latch = hmcs::HMCSLock;
+  using QNode = hmcs::HMCSQNode;
+
+  // Constructor
+  HMCSBench() : Bench<hmcs::HMCSLock>() {}
+
+  // Destructor
+  ~HMCSBench() {}
+
+  // Version read operation
+  bool LatchVersionRead(size_t node, size_t idx) override;
+
+  // Acquire-release operation
+  void LatchAcquireRelease(size_t node, size_t idx) override;
+};
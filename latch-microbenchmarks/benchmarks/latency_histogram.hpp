@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+
+// Latency histogram in the style of HdrHistogram: each power-of-two range of
+// cycles is split into kSubBuckets linear buckets, so any recorded value is
+// reported within 1/kSubBuckets of itself. Values below kSubBuckets are exact.
+struct LatencyHistogram {
+  static constexpr uint32_t kSubBucketBits = 4;
+  static constexpr uint64_t kSubBuckets = 1ull << kSubBucketBits;
+  static constexpr uint32_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  uint64_t buckets[kBuckets] = {};
+  uint64_t count = 0;
+  uint64_t max = 0;
+
+  static uint32_t BucketOf(uint64_t cycles) {
+    if (cycles < kSubBuckets) {
+      return cycles;
+    }
+    uint32_t msb = 63 - __builtin_clzll(cycles);
+    uint32_t shift = msb - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + ((cycles >> shift) & (kSubBuckets - 1));
+  }
+
+  // Largest value that falls into [bucket]
+  static uint64_t UpperBound(uint32_t bucket) {
+    if (bucket < kSubBuckets) {
+      return bucket;
+    }
+    uint32_t shift = bucket / kSubBuckets - 1;
+    uint64_t lower = (kSubBuckets + bucket % kSubBuckets) << shift;
+    return lower + (1ull << shift) - 1;
+  }
+
+  void Record(uint64_t cycles) {
+    ++buckets[BucketOf(cycles)];
+    ++count;
+    max = std::max(max, cycles);
+  }
+
+  void Merge(const LatencyHistogram &other) {
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+      buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    max = std::max(max, other.max);
+  }
+
+  // Upper bound (in cycles) of the bucket holding the given percentile
+  uint64_t Percentile(double p) const {
+    uint64_t rank = count * p / 100;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+      seen += buckets[i];
+      if (seen > rank) {
+        return std::min(max, UpperBound(i));
+      }
+    }
+    return max;
+  }
+
+  // JSON object with the number of samples, percentiles and maximum
+  void WriteJson(std::ostream &out) const {
+    out << "{\"samples\": " << count << ", \"p50\": " << Percentile(50)
+        << ", \"p99\": " << Percentile(99) << ", \"p99.9\": " << Percentile(99.9)
+        << ", \"max\": " << max << "}";
+  }
+};
@@ -13,8 +13,11 @@ void MCSBench::LatchAcquireRelease(size_t node, size_t idx) {
   Latch *latch = GetLatch(node, idx);
   QNode q;
 
+  uint64_t start = FLAGS_handoff_stats ? __rdtsc() : 0;
   latch->lock(&q);
-  CriticalSection();
+  AfterAcquire(node, idx, start);
+  CriticalSection(node, idx, true);
+  BeforeRelease(node, idx);
   latch->unlock(&q);
 }
 
@@ -54,7 +54,8 @@ bool MCSRWBench::LatchVersionRead(size_t node, size_t idx) {
   QNode q;
 #endif
   latch->read_lock(&q);
-  CriticalSection();
+  CriticalSection(node, idx, false);
+  VerifyRead();
   latch->read_unlock(&q);
   return true;
 }
@@ -69,8 +70,11 @@ void MCSRWBench::LatchAcquireRelease(size_t node, size_t idx) {
 #else
   QNode q;
 #endif
+  uint64_t start = FLAGS_handoff_stats ? __rdtsc() : 0;
   latch->lock(&q);
-  CriticalSection();
+  AfterAcquire(node, idx, start);
+  CriticalSection(node, idx, true);
+  BeforeRelease(node, idx);
   latch->unlock(&q);
 }
 
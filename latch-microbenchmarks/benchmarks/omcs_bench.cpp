@@ -21,43 +21,332 @@ std::atomic<uint32_t> next_node(0);
 #endif  // OMCS_OFFSET_NUMA_QNODE
 #endif  // OMCS_OFFSET
 
+#ifdef OMCS_OP_READ
+DEFINE_uint64(opread_stats, 0, "Count version read outcomes per latch (0: off, 1: on)");
+#endif
+
+#ifdef OMCS_ABORTABLE
+DEFINE_uint64(timeout_cycles, 0,
+              "Give up queueing for a latch after this many cycles and retry with another "
+              "queue node (0: wait without timeout)");
+#endif
+
+OMCSBench::OMCSBench() : Bench<Latch>() {
+#ifdef OMCS_OP_READ
+  // Latches are indexed by thread id under the fixed distribution, on every
+  // NUMA node
+  opread_stats_latches = nlatches;
+  for (auto &point : sweep) {
+    opread_stats_latches = std::max<size_t>(opread_stats_latches, point.threads);
+  }
+  opread_stats_nodes = distribution == Distribution::FIXED ? numa_max_node() + 1 : 1;
+
+  // Lock coupling reads through the plain LatchBeginRead()/LatchValidateRead()
+  LOG_IF(FATAL, FLAGS_opread_stats && FLAGS_depth > 1)
+      << "--opread_stats counts version reads, which lock coupling (--depth > 1) doesn't do";
+#endif
+#ifdef OMCS_ABORTABLE
+  LOG_IF(FATAL, FLAGS_timeout_cycles && FLAGS_depth > 1)
+      << "Lock coupling (--depth > 1) doesn't time out; drop --timeout_cycles";
+#endif
+}
+
+void OMCSBench::BeginRound(uint32_t round) {
+  Bench<Latch>::BeginRound(round);
+#ifdef OMCS_OP_READ
+  {
+    std::lock_guard<std::mutex> guard(opread_stats_mutex);
+    for (auto &stats : opread_stats) {
+      std::fill(stats->begin(), stats->end(), OpReadStats());
+    }
+  }
+#endif
+#ifdef OMCS_ABORTABLE
+  {
+    std::lock_guard<std::mutex> guard(acquire_stats_mutex);
+    for (auto &stats : acquire_stats) {
+      *stats = AcquireStats();
+    }
+  }
+#endif
+}
+
+std::vector<std::string> OMCSBench::ParameterFlags() {
+  std::vector<std::string> flags = Bench<Latch>::ParameterFlags();
+#ifdef OMCS_OP_READ
+  flags.push_back("opread_stats");
+#endif
+#ifdef OMCS_ABORTABLE
+  flags.push_back("timeout_cycles");
+#endif
+  return flags;
+}
+
+void OMCSBench::ReportLatchStats(std::ostream &json) {
+#ifdef OMCS_OP_READ
+  if (FLAGS_opread_stats) {
+    ReportOpReadStats(json);
+  }
+#endif
+#ifdef OMCS_ABORTABLE
+  if (FLAGS_timeout_cycles) {
+    ReportAcquireStats(json);
+  }
+#endif
+  Bench<Latch>::ReportLatchStats(json);
+}
+
 bool OMCSBench::LatchVersionRead(size_t node, size_t idx) {
   Latch *latch = GetLatch(node, idx);
   bool restart = false;
   uint64_t v = latch->try_begin_read(restart);
+#ifdef OMCS_OP_READ
+  if (FLAGS_opread_stats) {
+    OpReadStats &stats = GetOpReadStats(node, idx);
+    ++stats.reads;
+    if (restart) {
+      ++stats.restarts;
+      return false;
+    }
+    CriticalSection(node, idx, false);
+    bool succeeded = latch->validate_read(v);
+    bool consistent = succeeded && VerifyRead();
+    if (Latch::is_opread(v)) {
+      ++stats.opreads;
+      if (succeeded) {
+        ++stats.opread_successes;
+        if (!consistent) {
+          ++stats.opread_torn;
+        }
+      }
+    }
+    return succeeded;
+  }
+#endif
   if (restart) {
     return false;
   }
-  CriticalSection();
-  return latch->validate_read(v);
+  CriticalSection(node, idx, false);
+  if (!latch->validate_read(v)) {
+    return false;
+  }
+  VerifyRead();
+  return true;
+}
+
+#ifdef OMCS_OP_READ
+OMCSBench::OpReadStats &OMCSBench::GetOpReadStats(size_t node, size_t idx) {
+  thread_local std::vector<OpReadStats> *stats = nullptr;
+  if (!stats) {
+    std::lock_guard<std::mutex> guard(opread_stats_mutex);
+    opread_stats.emplace_back(
+        new std::vector<OpReadStats>(opread_stats_nodes * opread_stats_latches));
+    stats = opread_stats.back().get();
+  }
+  return (*stats)[node * opread_stats_latches + idx];
+}
+
+void OMCSBench::ReportOpReadStats(std::ostream &json) {
+  // Latches most often found locked, listed besides the total
+  static constexpr size_t kTopLatches = 16;
+
+  // Prints one latch (or all of them), and adds it to [json] as an object
+  auto print = [&](const std::string &name, const OpReadStats &s) {
+    // Share of reads that found the latch locked and still succeeded
+    uint64_t locked_reads = s.restarts + s.opreads;
+    double hit_rate = locked_reads ? s.opread_successes / (double)locked_reads : 0;
+    std::cout << name
+              << "," << s.reads
+              << "," << s.restarts
+              << "," << s.opreads
+              << "," << s.opread_successes
+              << "," << hit_rate
+              << "," << s.opread_torn
+              << std::endl;
+    json << "{\"latch\": " << JsonString(name) << ", \"reads\": " << s.reads
+         << ", \"restarts\": " << s.restarts << ", \"opreads\": " << s.opreads
+         << ", \"opread_successes\": " << s.opread_successes
+         << ", \"opread_hit_rate\": " << JsonNumber(hit_rate)
+         << ", \"opread_torn\": " << s.opread_torn << "}";
+  };
+
+  OpReadStats all;
+  std::vector<std::pair<size_t, OpReadStats>> latches;
+  for (size_t i = 0; i < opread_stats_nodes * opread_stats_latches; ++i) {
+    OpReadStats total;
+    for (auto &stats : opread_stats) {
+      total.reads += (*stats)[i].reads;
+      total.restarts += (*stats)[i].restarts;
+      total.opreads += (*stats)[i].opreads;
+      total.opread_successes += (*stats)[i].opread_successes;
+      total.opread_torn += (*stats)[i].opread_torn;
+    }
+    all.reads += total.reads;
+    all.restarts += total.restarts;
+    all.opreads += total.opreads;
+    all.opread_successes += total.opread_successes;
+    all.opread_torn += total.opread_torn;
+    if (total.restarts + total.opreads) {
+      latches.emplace_back(i, total);
+    }
+  }
+  auto locked_reads = [](const std::pair<size_t, OpReadStats> &l) {
+    return l.second.restarts + l.second.opreads;
+  };
+  size_t top = std::min(kTopLatches, latches.size());
+  std::partial_sort(latches.begin(), latches.begin() + top, latches.end(),
+                    [&](auto &a, auto &b) { return locked_reads(a) > locked_reads(b); });
+
+  std::cout << "=====================" << std::endl;
+  std::cout << "Latch,Reads,Restarts,OpReads,OpReadSuccesses,OpReadHitRate,OpReadTorn: " << std::endl;
+  json << ", \"opread\": ";
+  print("All", all);
+  json << ", \"opread_top_latches\": [";
+  for (size_t i = 0; i < top; ++i) {
+    size_t latch = latches[i].first;
+    json << (i ? ", " : "");
+    print(std::to_string(latch / opread_stats_latches) + ":" +
+              std::to_string(latch % opread_stats_latches),
+          latches[i].second);
+  }
+  json << "]";
+}
+#endif
+
+#ifdef OMCS_OFFSET
+// Takes the next queue node from the pool; with OMCS_OFFSET_NUMA_QNODE, from a
+// page local to the calling thread's socket
+static OMCSBench::QNode *AllocQNode() {
+#ifdef OMCS_OFFSET_NUMA_QNODE
+  uint32_t socket = numa_node_of_cpu(sched_getcpu());
+  uint32_t qnodes_per_page = PAGE_SIZE / sizeof(OMCSBench::QNode);
+  uint32_t index = socket_qnode_index[socket].index++;
+
+  uint32_t nsockets = numa_max_node() + 1;
+  uint32_t page_num = index / qnodes_per_page * nsockets + socket; 
+  index = page_num * qnodes_per_page + index % qnodes_per_page;
+  return &omcs_impl::base_qnode[index];
+#else
+  return &omcs_impl::base_qnode[next_node++];
+#endif  // OMCS_OFFSET_NUMA_QNODE
+}
+#endif  // OMCS_OFFSET
+
+#ifdef OMCS_ABORTABLE
+OMCSBench::AcquireStats &OMCSBench::GetAcquireStats() {
+  thread_local AcquireStats *stats = nullptr;
+  if (!stats) {
+    std::lock_guard<std::mutex> guard(acquire_stats_mutex);
+    acquire_stats.emplace_back(new AcquireStats);
+    stats = acquire_stats.back().get();
+  }
+  return *stats;
+}
+
+void OMCSBench::ReportAcquireStats(std::ostream &json) {
+  AcquireStats total;
+  for (auto &stats : acquire_stats) {
+    total.latencies.Merge(stats->latencies);
+    total.timeouts += stats->timeouts;
+  }
+
+  std::cout << "=====================" << std::endl;
+  std::cout << "Acquires,Timeouts,P50,P99,P99.9,Max (cycles): " << std::endl;
+  std::cout << total.latencies.count
+            << "," << total.timeouts
+            << "," << total.latencies.Percentile(50)
+            << "," << total.latencies.Percentile(99)
+            << "," << total.latencies.Percentile(99.9)
+            << "," << total.latencies.max
+            << std::endl;
+
+  json << ", \"acquire_timeouts\": " << total.timeouts << ", \"acquire_latency_cycles\": ";
+  total.latencies.WriteJson(json);
+}
+#endif  // OMCS_ABORTABLE
+
+// Queue node of the calling thread for LatchLock()/LatchUnlock()
+static OMCSBench::QNode *LocalQNode() {
+#ifdef OMCS_OFFSET
+  thread_local OMCSBench::QNode *qnode = nullptr;
+  if (!qnode) {
+    qnode = AllocQNode();
+  }
+  return qnode;
+#else
+  thread_local OMCSBench::QNode qnode;
+  return &qnode;
+#endif
+}
+
+void OMCSBench::LatchLock(size_t node, size_t idx) {
+  QNode *q = LocalQNode();
+  new (q) QNode;
+  GetLatch(node, idx)->lock(q);
+}
+
+void OMCSBench::LatchUnlock(size_t node, size_t idx) {
+  GetLatch(node, idx)->unlock(LocalQNode());
 }
 
 std::mutex l;
 void OMCSBench::LatchAcquireRelease(size_t node, size_t idx) {
   Latch *latch = GetLatch(node, idx);
+#ifdef OMCS_ABORTABLE
+  if (FLAGS_timeout_cycles) {
+    // A timed-out queue node stays in the latch's queue until the holder skips
+    // it, so each thread rotates through a few of them
+    static constexpr uint32_t kTimedQNodes = 4;
+#ifdef OMCS_OFFSET
+    thread_local QNode *qnodes[kTimedQNodes] = {};
+    if (!qnodes[0]) {
+      for (uint32_t i = 0; i < kTimedQNodes; ++i) {
+        qnodes[i] = AllocQNode();
+        new (qnodes[i]) QNode;
+      }
+    }
+#else
+    thread_local QNode qnode_ring[kTimedQNodes];
+    thread_local QNode *qnodes[kTimedQNodes] = {
+        &qnode_ring[0], &qnode_ring[1], &qnode_ring[2], &qnode_ring[3]};
+#endif
+    thread_local uint32_t current = 0;
+
+    AcquireStats &stats = GetAcquireStats();
+    uint64_t start = __rdtsc();
+    while (true) {
+      QNode *q = qnodes[current];
+      while (q->is_abandoned()) {
+        _mm_pause();
+      }
+      if (latch->try_lock_for(q, FLAGS_timeout_cycles)) {
+        break;
+      }
+      ++stats.timeouts;
+      current = (current + 1) % kTimedQNodes;
+    }
+    stats.latencies.Record(__rdtsc() - start);
+
+    CriticalSection(node, idx, true);
+    latch->unlock(qnodes[current]);
+    return;
+  }
+#endif  // OMCS_ABORTABLE
 #ifdef OMCS_OFFSET
   thread_local QNode *qnode = nullptr;
   if (!qnode) {
-#ifdef OMCS_OFFSET_NUMA_QNODE
-    uint32_t socket = numa_node_of_cpu(sched_getcpu());
-    uint32_t qnodes_per_page = PAGE_SIZE / sizeof(OMCSBench::QNode);
-    uint32_t index = socket_qnode_index[socket].index++;
-
-    uint32_t nsockets = numa_max_node() + 1;
-    uint32_t page_num = index / qnodes_per_page * nsockets + socket; 
-    index = page_num * qnodes_per_page + index % qnodes_per_page;
-    qnode = &omcs_impl::base_qnode[index];
-#else
-    qnode = &omcs_impl::base_qnode[next_node++];
-#endif  // OMCS_OFFSET_NUMA_QNODE
+    qnode = AllocQNode();
   }
   QNode &q = *qnode;
   new (qnode) QNode;
 #else
   QNode q;
 #endif
+  uint64_t start = FLAGS_handoff_stats ? __rdtsc() : 0;
   latch->lock(&q);
-  CriticalSection();
+  AfterAcquire(node, idx, start);
+  CriticalSection(node, idx, true);
+  BeforeRelease(node, idx);
   latch->unlock(&q);
 }
 
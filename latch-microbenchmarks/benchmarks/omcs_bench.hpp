@@ -1,18 +1,39 @@
 #pragma once
 
+#ifdef OMCS_COHORT
+#include "latches/OMCSCohort.h"
+#else
 #include "latches/OMCSImpl.h"
+#endif
+#include "latency_histogram.hpp"
 #include "perf.hpp"
 
+#if defined(OMCS_OP_READ) || defined(OMCS_ABORTABLE)
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
 #ifdef OMCS_OFFSET
 extern omcs_impl::OMCSQNode *omcs_impl::base_qnode;
 #endif
 
-struct OMCSBench : public Bench<omcs_impl::OMCSLock> {
-  using Latch = omcs_impl::OMCSLock;
+#ifdef OMCS_OP_READ
+DECLARE_uint64(opread_stats);
+#endif
+
+#ifdef OMCS_COHORT
+using OMCSBenchLatch = omcs_impl::OMCSCohortLock;
+#else
+using OMCSBenchLatch = omcs_impl::OMCSLock;
+#endif
+
+struct OMCSBench : public Bench<OMCSBenchLatch> {
+  using Latch = OMCSBenchLatch;
   using QNode = omcs_impl::OMCSQNode;
 
   // Constructor
-  OMCSBench() : Bench<Latch>() {}
+  OMCSBench();
 
   // Destructor
   ~OMCSBench() {}
@@ -22,6 +43,60 @@ struct OMCSBench : public Bench<omcs_impl::OMCSLock> {
 
   // Acquire-release operation
   void LatchAcquireRelease(size_t node, size_t idx) override;
+
+  // Resets the OMCS-specific stats below for the round
+  void BeginRound(uint32_t round) override;
+
+  std::vector<std::string> ParameterFlags() override;
+  void ReportLatchStats(std::ostream &json) override;
+
+  // Lock coupling primitives
+  void LatchLock(size_t node, size_t idx) override;
+  void LatchUnlock(size_t node, size_t idx) override;
+
+#ifdef OMCS_OP_READ
+  // Per-latch version read outcomes of one worker thread
+  struct OpReadStats {
+    uint64_t reads = 0;
+    uint64_t restarts = 0;          // Latch was locked and not open for op-read
+    uint64_t opreads = 0;           // Read under a locked latch (op-read)
+    uint64_t opread_successes = 0;  // ... that validated
+    uint64_t opread_torn = 0;       // ... but copied an inconsistent payload
+  };
+
+  // Returns the calling thread's counters for the given latch
+  // (--opread_stats=1)
+  OpReadStats &GetOpReadStats(size_t node, size_t idx);
+
+  // Prints the op-read hit rate of all latches, and of those most often
+  // found locked, and adds them to [json]
+  void ReportOpReadStats(std::ostream &json);
+
+  // Latches per NUMA node in each thread's counters, and the number of nodes
+  size_t opread_stats_latches;
+  size_t opread_stats_nodes;
+
+  std::mutex opread_stats_mutex;
+  std::vector<std::unique_ptr<std::vector<OpReadStats>>> opread_stats;
+#endif
+
+#ifdef OMCS_ABORTABLE
+  // Acquire latencies of one worker thread
+  struct AcquireStats {
+    LatencyHistogram latencies;
+    uint64_t timeouts = 0;  // Attempts that gave up and retried
+  };
+
+  // Returns the calling thread's acquire latency counters
+  AcquireStats &GetAcquireStats();
+
+  // Prints acquire latency percentiles and the number of timeouts, and adds
+  // them to [json]
+  void ReportAcquireStats(std::ostream &json);
+
+  std::mutex acquire_stats_mutex;
+  std::vector<std::unique_ptr<AcquireStats>> acquire_stats;
+#endif
 };
 
 
@@ -11,23 +11,48 @@ bool OptLockBench::LatchVersionRead(size_t node, size_t idx) {
   if (restart) {
     return false;
   }
-  CriticalSection();
-  return latch->validate_read(v);
+  CriticalSection(node, idx, false);
+  if (!latch->validate_read(v)) {
+    return false;
+  }
+  VerifyRead();
+  return true;
 }
 
 void OptLockBench::LatchAcquireRelease(size_t node, size_t idx) {
   Latch *latch = GetLatch(node, idx);
 #if defined(ST_ONLY)
   uint64_t v = latch->lock();
-  CriticalSection();
+  CriticalSection(node, idx, true);
   latch->unlock(v);
 #else
   latch->lock();
-  CriticalSection();
+  CriticalSection(node, idx, true);
   latch->unlock();
 #endif
 }
 
+#if defined(ST_ONLY)
+// Version returned by lock(), for unlock()
+thread_local uint64_t locked_version;
+#endif
+
+void OptLockBench::LatchLock(size_t node, size_t idx) {
+#if defined(ST_ONLY)
+  locked_version = GetLatch(node, idx)->lock();
+#else
+  GetLatch(node, idx)->lock();
+#endif
+}
+
+void OptLockBench::LatchUnlock(size_t node, size_t idx) {
+#if defined(ST_ONLY)
+  GetLatch(node, idx)->unlock(locked_version);
+#else
+  GetLatch(node, idx)->unlock();
+#endif
+}
+
 int main(int argc, char **argv) {
   ::google::InitGoogleLogging(argv[0]);
   ::testing::InitGoogleTest(&argc, argv);
@@ -17,4 +17,8 @@ struct OptLockBench : public Bench<omcs_impl::OMCSLock> {
 
   // Acquire-release operation
   void LatchAcquireRelease(size_t node, size_t idx) override;
+
+  // Lock coupling primitives
+  void LatchLock(size_t node, size_t idx) override;
+  void LatchUnlock(size_t node, size_t idx) override;
 };
@@ -1,13 +1,71 @@
 #include "perf.hpp"
 
 #include <numa.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
 #include <iomanip>
+#include <sstream>
 
 #include "sched.hpp"
+#include "../../index-benchmarks/common/perf_counters.h"
+
+static bool ValidatePin(const char *flagname, const std::string &value) {
+  topology::policy p;
+  if (topology::parse_policy(value, p)) {
+    return true;
+  }
+  printf("Unknown placement policy %s\n", value.c_str());
+  return false;
+}
+
+DEFINE_string(pin, "smt_last",
+              "Thread placement: compact, scatter (across NUMA nodes) or smt_last "
+              "(SMT siblings after all cores)");
+DEFINE_validator(pin, ValidatePin);
+
+DEFINE_uint64(latency_sample_rate, 0,
+              "Measure the latency of one in every this many operations (0: off)");
+DEFINE_uint64(interval_ms, 0,
+              "Report per-thread throughput and fairness every this many milliseconds (0: off)");
+DEFINE_uint64(perf_counters, 0,
+              "Count cycles, instructions, LLC misses and remote HITMs per operation (0: off, 1: on)");
+DEFINE_string(json, "", "Also write the parameters and results of each round to this JSON file");
+
+// JSON string literal
+std::string JsonString(const std::string &s) {
+  std::ostringstream out;
+  out << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if ((unsigned char)c < 0x20) {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+// JSON number, or null where JSON has none (NaN, infinity)
+std::string JsonNumber(double v) {
+  if (!std::isfinite(v)) {
+    return "null";
+  }
+  std::ostringstream out;
+  out << std::setprecision(17) << v;
+  return out.str();
+}
 
 PerformanceTest::PerformanceTest(uint32_t threads, uint32_t seconds)
     : bench_start_barrier(false),
       thread_start_barrier(0),
+      thread_finish_barrier(0),
+      round(0),
+      exiting(false),
       shutdown(false),
       nthreads(threads),
       seconds(seconds) {}
@@ -20,27 +78,127 @@ void PerformanceTest::Execute(uint32_t thread_id) {
   // Pin self to the corresponding CPU core
   set_affinity(thread_id);
 
-  // 1. Mark self as ready using the thread start barrier
-  ++thread_start_barrier;
+  uint64_t last_round = 0;
+  while (true) {
+    // 1. Sleep until the next round or the end of the benchmark
+    {
+      std::unique_lock<std::mutex> guard(round_mutex);
+      round_cv.wait(guard, [&] { return exiting || round != last_round; });
+      if (exiting) {
+        return;
+      }
+      last_round = round;
+    }
+    if (thread_id >= nthreads) {
+      continue;
+    }
 
-  // 2. Wait for others to become ready
-  while (!bench_start_barrier) {
-  }
+    // 2. Mark self as ready using the thread start barrier
+    ++thread_start_barrier;
+
+    // 3. Wait for others to become ready
+    while (!bench_start_barrier) {
+    }
 
-  // 3. Do real work until shutdown
-  WorkerRun(get_node_id(thread_id), thread_id);
+    // 4. Do real work until shutdown
+    if (FLAGS_perf_counters) {
+      perf_counters::start_thread();
+    }
+    WorkerRun(get_node_id(thread_id), thread_id);
+    ++thread_finish_barrier;
+  }
 }
 
 void PerformanceTest::Run() {
-  // 1. Start threads and initialize the commit/abort stats for each thread to 0
-  for (uint32_t i = 0; i < nthreads; ++i) {
+  // Discover the topology before any worker pins itself
+  std::cout << "Placement: " << FLAGS_pin << " over "
+            << topology::placement(pin_policy()).size() << " CPUs" << std::endl;
+
+  // 1. Start the threads of the largest round; each round resets their stats
+  uint32_t rounds = Rounds();
+  uint32_t pool_size = 0;
+  for (uint32_t r = 0; r < rounds; ++r) {
+    pool_size = std::max(pool_size, RoundThreads(r));
+  }
+  for (uint32_t i = 0; i < pool_size; ++i) {
     noperations.emplace_back(0);
     nsuccesses.emplace_back(0);
     reads.emplace_back(0);
     read_successes.emplace_back(0);
+    verified_reads.emplace_back(0);
+    torn_reads.emplace_back(0);
+    traversals.emplace_back(0);
+    restarts.emplace_back(0);
+    latencies.emplace_back(new OperationLatencies);
+    progress.emplace_back(new Progress);
     workers.push_back(new std::thread(&PerformanceTest::Execute, this, i));
   }
 
+  // 2. Run the rounds
+  for (uint32_t r = 0; r < rounds; ++r) {
+    nthreads = RoundThreads(r);
+    BeginRound(r);
+    perf_counters::counts before;
+    if (FLAGS_perf_counters) {
+      before = perf_counters::sum();
+    }
+    RunRound();
+    perf_counters::counts counters;
+    if (FLAGS_perf_counters) {
+      counters = perf_counters::sum();
+      // Scaling for multiplexing may make a counter appear to go back a bit
+      for (uint32_t i = 0; i < perf_counters::kNumEvents; ++i) {
+        counters.values[i] =
+            counters.values[i] > before.values[i] ? counters.values[i] - before.values[i] : 0;
+      }
+    }
+    Report(counters);
+  }
+
+  // 3. Let all workers exit
+  {
+    std::lock_guard<std::mutex> guard(round_mutex);
+    exiting = true;
+  }
+  round_cv.notify_all();
+  for (auto &t : workers) {
+    t->join();
+    delete t;
+  }
+  workers.clear();
+
+  if (!FLAGS_json.empty()) {
+    WriteJson();
+  }
+}
+
+void PerformanceTest::RunRound() {
+  for (uint32_t i = 0; i < noperations.size(); ++i) {
+    noperations[i] = 0;
+    nsuccesses[i] = 0;
+    reads[i] = 0;
+    read_successes[i] = 0;
+    verified_reads[i] = 0;
+    torn_reads[i] = 0;
+    traversals[i] = 0;
+    restarts[i] = 0;
+    *latencies[i] = OperationLatencies();
+    progress[i]->successes = 0;
+  }
+  intervals.clear();
+  thread_start_barrier = 0;
+  thread_finish_barrier = 0;
+  bench_start_barrier = false;
+  shutdown = false;
+
+  // 1. Wake up the threads of this round, in the first phase
+  BeginPhase(0);
+  {
+    std::lock_guard<std::mutex> guard(round_mutex);
+    ++round;
+  }
+  round_cv.notify_all();
+
   // 2. Wait for all threads to become ready
   while (thread_start_barrier != nthreads) {
   }
@@ -50,19 +208,22 @@ void PerformanceTest::Run() {
 
   // 4. Sleep for the benchmark duration
   std::cout << "Benchmarking..." << std::flush;
-  sleep(seconds);
+  if (FLAGS_interval_ms || Phases() > 1) {
+    SampleIntervals();
+  } else {
+    sleep(seconds);
+  }
 
   // 5. Issue a 'stop' signal to all threads
   shutdown = true;
   std::cout << "Done" << std::endl;
 
   // 6. Wait for all workers to finish
-  for (auto &t : workers) {
-    t->join();
-    delete t;
+  while (thread_finish_barrier != nthreads) {
   }
+}
 
-  // 7. Dump stats
+void PerformanceTest::Report(const perf_counters::counts &counters) {
   std::cout << "=====================" << std::endl;
   std::cout << "Thread,Operations/s,Successes/s: " << std::endl;
 
@@ -73,7 +234,7 @@ void PerformanceTest::Run() {
   uint64_t total_successes = 0;
   uint64_t total_reads = 0;
   uint64_t total_read_successes = 0;
-  for (uint32_t i = 0; i < noperations.size(); ++i) {
+  for (uint32_t i = 0; i < nthreads; ++i) {
     std::cout << i
               << "," << noperations[i] / (double)seconds
               << "," << nsuccesses[i] / (double)seconds
@@ -93,4 +254,260 @@ void PerformanceTest::Run() {
             << "," << total_reads / (double)seconds
             << "," << total_read_successes / (double)seconds
             << std::endl;
+
+  uint64_t total_traversals = 0;
+  uint64_t total_restarts = 0;
+  for (uint32_t i = 0; i < nthreads; ++i) {
+    total_traversals += traversals[i];
+    total_restarts += restarts[i];
+  }
+  if (total_traversals) {
+    std::cout << "=====================" << std::endl;
+    std::cout << "Traversals,Restarts,Restarts/traversal: " << std::endl;
+    std::cout << total_traversals << "," << total_restarts << ","
+              << total_restarts / (double)total_traversals << std::endl;
+  }
+
+  uint64_t total_verified_reads = 0;
+  uint64_t total_torn_reads = 0;
+  for (uint32_t i = 0; i < nthreads; ++i) {
+    total_verified_reads += verified_reads[i];
+    total_torn_reads += torn_reads[i];
+  }
+  if (total_verified_reads) {
+    std::cout << "=====================" << std::endl;
+    std::cout << "Verified reads,Torn reads: " << std::endl;
+    std::cout << total_verified_reads << "," << total_torn_reads << std::endl;
+    if (total_torn_reads) {
+      std::cout << "ERROR: reads validated with an inconsistent payload" << std::endl;
+    }
+  }
+
+  if (FLAGS_latency_sample_rate) {
+    ReportLatencies();
+  }
+  if (FLAGS_interval_ms) {
+    ReportIntervals();
+  }
+  if (FLAGS_perf_counters) {
+    std::cout << "=====================" << std::endl;
+    perf_counters::print(counters, total_operations);
+  }
+  std::ostringstream latch_stats;
+  ReportLatchStats(latch_stats);
+
+  if (FLAGS_json.empty()) {
+    return;
+  }
+
+  // The same numbers for --json, with the benchmark's flags as parameters
+  std::ostringstream json;
+  json << "{\"parameters\": {";
+  bool first = true;
+  for (auto &name : ParameterFlags()) {
+    gflags::CommandLineFlagInfo flag;
+    LOG_IF(FATAL, !gflags::GetCommandLineFlagInfo(name.c_str(), &flag)) << "No flag --" << name;
+    json << (first ? "" : ", ") << JsonString(flag.name) << ": ";
+    if (flag.type == "string" || flag.type == "bool") {
+      json << (flag.type == "bool" ? flag.current_value : JsonString(flag.current_value));
+    } else {
+      json << flag.current_value;
+    }
+    first = false;
+  }
+  json << "}, \"results\": {";
+  json << "\"threads\": " << nthreads << ", \"seconds\": " << seconds;
+  json << ", \"operations_per_second\": " << JsonNumber(total_operations / (double)seconds);
+  json << ", \"successes_per_second\": " << JsonNumber(total_successes / (double)seconds);
+  json << ", \"reads_per_second\": " << JsonNumber(total_reads / (double)seconds);
+  json << ", \"read_successes_per_second\": "
+       << JsonNumber(total_read_successes / (double)seconds);
+  json << ", \"per_thread\": [";
+  for (uint32_t i = 0; i < nthreads; ++i) {
+    json << (i ? ", " : "")
+         << "{\"operations_per_second\": " << JsonNumber(noperations[i] / (double)seconds)
+         << ", \"successes_per_second\": " << JsonNumber(nsuccesses[i] / (double)seconds)
+         << ", \"reads_per_second\": " << JsonNumber(reads[i] / (double)seconds)
+         << ", \"read_successes_per_second\": " << JsonNumber(read_successes[i] / (double)seconds)
+         << "}";
+  }
+  json << "]";
+  json << ", \"traversals\": " << total_traversals << ", \"restarts\": " << total_restarts;
+  json << ", \"verified_reads\": " << total_verified_reads
+       << ", \"torn_reads\": " << total_torn_reads;
+  if (FLAGS_latency_sample_rate) {
+    LatencyHistogram read_latencies;
+    LatencyHistogram acquire_release_latencies;
+    for (uint32_t i = 0; i < nthreads; ++i) {
+      read_latencies.Merge(latencies[i]->reads);
+      acquire_release_latencies.Merge(latencies[i]->acquire_releases);
+    }
+    json << ", \"latency_cycles\": {\"version_read\": ";
+    read_latencies.WriteJson(json);
+    json << ", \"acquire_release\": ";
+    acquire_release_latencies.WriteJson(json);
+    json << "}";
+  }
+  if (FLAGS_interval_ms) {
+    json << ", \"intervals\": [";
+    for (uint32_t n = 0; n < intervals.size(); ++n) {
+      const Interval &interval = intervals[n];
+      double per_second = 1000 / interval.length_ms;
+      uint64_t sum = 0;
+      for (uint64_t s : interval.successes) {
+        sum += s;
+      }
+      json << (n ? ", " : "") << "{\"time_ms\": " << JsonNumber(interval.end_ms)
+           << ", \"phase\": " << interval.phase << ", \"threads\": " << interval.threads
+           << ", \"successes_per_second\": " << JsonNumber(sum * per_second)
+           << ", \"jain\": " << JsonNumber(interval.Jain()) << ", \"per_thread\": [";
+      for (uint32_t i = 0; i < interval.successes.size(); ++i) {
+        json << (i ? ", " : "") << JsonNumber(interval.successes[i] * per_second);
+      }
+      json << "]}";
+    }
+    json << "]";
+  }
+  if (FLAGS_perf_counters) {
+    json << ", \"perf_counters\": {";
+    for (uint32_t i = 0; i < perf_counters::kNumEvents; ++i) {
+      json << (i ? ", " : "") << JsonString(perf_counters::kEventNames[i]) << ": ";
+      if (counters.available[i]) {
+        json << "{\"total\": " << counters.values[i] << ", \"per_operation\": "
+             << JsonNumber(total_operations ? counters.values[i] / (double)total_operations : 0)
+             << "}";
+      } else {
+        json << "null";
+      }
+    }
+    json << "}";
+  }
+  json << latch_stats.str();
+  json << "}}";
+  json_rounds.push_back(json.str());
+}
+
+std::vector<std::string> PerformanceTest::ParameterFlags() {
+  return {"pin", "latency_sample_rate", "interval_ms", "perf_counters"};
+}
+
+void PerformanceTest::WriteJson() {
+  std::ofstream out(FLAGS_json);
+  LOG_IF(FATAL, !out) << "Cannot write " << FLAGS_json;
+  out << "{\"benchmark\": " << JsonString(gflags::ProgramInvocationShortName())
+      << ",\n \"rounds\": [";
+  for (uint32_t r = 0; r < json_rounds.size(); ++r) {
+    out << (r ? ",\n  " : "\n  ") << json_rounds[r];
+  }
+  out << "\n]}" << std::endl;
+}
+
+void PerformanceTest::SampleIntervals() {
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  auto end = start + std::chrono::seconds(seconds);
+  auto last = start;
+  auto next_sample = FLAGS_interval_ms ? start + std::chrono::milliseconds(FLAGS_interval_ms)
+                                       : clock::time_point::max();
+  uint32_t phase = 0;
+  std::vector<uint64_t> last_successes(nthreads, 0);
+  while (true) {
+    auto next_phase = phase + 1 < Phases()
+                          ? start + std::chrono::milliseconds(PhaseStartMs(phase + 1))
+                          : clock::time_point::max();
+    auto next = std::min(next_sample, next_phase);
+    if (next > end) {
+      break;
+    }
+    std::this_thread::sleep_until(next);
+
+    // An interval that ends as a phase starts belongs to the previous phase
+    if (next_sample == next) {
+      auto now = clock::now();
+      Interval interval;
+      interval.end_ms = std::chrono::duration<double, std::milli>(now - start).count();
+      interval.length_ms = std::chrono::duration<double, std::milli>(now - last).count();
+      interval.phase = phase;
+      interval.threads = PhaseThreads(phase);
+      for (uint32_t i = 0; i < nthreads; ++i) {
+        uint64_t successes = progress[i]->successes.load(std::memory_order_relaxed);
+        interval.successes.push_back(successes - last_successes[i]);
+        last_successes[i] = successes;
+      }
+      intervals.push_back(std::move(interval));
+      last = now;
+      next_sample += std::chrono::milliseconds(FLAGS_interval_ms);
+    }
+    if (next_phase == next) {
+      BeginPhase(++phase);
+    }
+  }
+  std::this_thread::sleep_until(end);
+}
+
+double PerformanceTest::Interval::Jain() const {
+  double sum = 0;
+  double sum_of_squares = 0;
+  for (uint32_t i = 0; i < threads && i < successes.size(); ++i) {
+    sum += successes[i];
+    sum_of_squares += (double)successes[i] * successes[i];
+  }
+  return sum_of_squares ? sum * sum / (threads * sum_of_squares) : NAN;
+}
+
+void PerformanceTest::ReportIntervals() {
+  std::cout << "=====================" << std::endl;
+  std::cout << "Time series (every " << FLAGS_interval_ms << " ms): " << std::endl;
+  std::cout << "Interval,Time (ms),Successes/s,Jain";
+  if (Phases() > 1) {
+    std::cout << ",Phase";
+  }
+  for (uint32_t i = 0; i < nthreads; ++i) {
+    std::cout << ",Thread " << i;
+  }
+  std::cout << std::endl;
+
+  for (uint32_t n = 0; n < intervals.size(); ++n) {
+    const Interval &interval = intervals[n];
+    double per_second = 1000 / interval.length_ms;
+    uint64_t sum = 0;
+    for (uint64_t s : interval.successes) {
+      sum += s;
+    }
+    std::cout << n
+              << "," << interval.end_ms
+              << "," << sum * per_second
+              << "," << interval.Jain();
+    if (Phases() > 1) {
+      std::cout << "," << interval.phase;
+    }
+    for (uint64_t s : interval.successes) {
+      std::cout << "," << s * per_second;
+    }
+    std::cout << std::endl;
+  }
+}
+
+void PerformanceTest::ReportLatencies() {
+  LatencyHistogram reads;
+  LatencyHistogram acquire_releases;
+  for (auto &l : latencies) {
+    reads.Merge(l->reads);
+    acquire_releases.Merge(l->acquire_releases);
+  }
+
+  std::cout << "=====================" << std::endl;
+  std::cout << "Operation,Samples,P50,P99,P99.9,Max (cycles, 1 in "
+            << FLAGS_latency_sample_rate << " operations): " << std::endl;
+  auto print = [](const char *name, const LatencyHistogram &h) {
+    std::cout << name
+              << "," << h.count
+              << "," << h.Percentile(50)
+              << "," << h.Percentile(99)
+              << "," << h.Percentile(99.9)
+              << "," << h.max
+              << std::endl;
+  };
+  print("VersionRead", reads);
+  print("AcquireRelease", acquire_releases);
 }
@@ -4,9 +4,15 @@
 #include <glog/logging.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
+#include "latency_histogram.hpp"
 #include "third_party/foedus/uniform_random.hpp"
 
 #ifndef CACHELINE_SIZE
@@ -15,6 +21,19 @@
 
 #define CACHE_ALIGNED __attribute__((aligned(CACHELINE_SIZE)))
 
+DECLARE_uint64(latency_sample_rate);
+DECLARE_uint64(interval_ms);
+DECLARE_uint64(perf_counters);
+DECLARE_string(json);
+
+namespace perf_counters {
+struct counts;
+}
+
+// JSON literals for --json
+std::string JsonString(const std::string &s);
+std::string JsonNumber(double v);  // null unless finite
+
 struct PerformanceTest {
   // Constructor
   // @threads: number of benchmark worker threads
@@ -33,25 +52,117 @@ struct PerformanceTest {
   // Entrance function to run a benchmark
   void Run();
 
+  // Rounds of a sweep, which Run() benchmarks one after another with the same
+  // latches and worker threads: the number of rounds, the threads each round
+  // uses, and a hook that sets up a round while all workers are parked
+  virtual uint32_t Rounds() { return 1; }
+  virtual uint32_t RoundThreads(uint32_t /*round*/) { return nthreads; }
+  virtual void BeginRound(uint32_t /*round*/) {}
+
+  // Phases of a round, which change the workload at given times while the
+  // workers run: the number of phases, when each starts (ms since the start of
+  // the round; phase 0 at 0), the threads active in each, and a hook that
+  // switches to a phase (called from the main thread)
+  virtual uint32_t Phases() { return 1; }
+  virtual uint64_t PhaseStartMs(uint32_t /*phase*/) { return 0; }
+  virtual uint32_t PhaseThreads(uint32_t /*phase*/) { return nthreads; }
+  virtual void BeginPhase(uint32_t /*phase*/) {}
+
+  // Runs one round with the first [nthreads] workers
+  void RunRound();
+
+  // Prints the stats of the last round, and keeps them for --json
+  void Report(const perf_counters::counts &counters);
+
+  // Flags that parameterize the benchmark, reported with every round in --json
+  virtual std::vector<std::string> ParameterFlags();
+
+  // Prints the latch-specific stats of the last round, such as handoff
+  // latencies, and appends them to [json] as members of the round's results
+  // (each preceded by ", "). Benchmarks reset them in BeginRound().
+  virtual void ReportLatchStats(std::ostream &/*json*/) {}
+
+  // Writes the parameters and stats of all rounds to --json
+  void WriteJson();
+
+  // One JSON object per round
+  std::vector<std::string> json_rounds;
+
   // One entry per thread to record the number of finished operations
   std::vector<uint64_t> noperations;
   std::vector<uint64_t> nsuccesses;
   std::vector<uint64_t> reads;
   std::vector<uint64_t> read_successes;
 
+  // Successful reads whose payload copy was checked, and those that found it
+  // torn (--cs_mode=write)
+  std::vector<uint64_t> verified_reads;
+  std::vector<uint64_t> torn_reads;
+
+  // Completed lock-coupling traversals and their restarts (--depth > 1)
+  std::vector<uint64_t> traversals;
+  std::vector<uint64_t> restarts;
+
+  // Latencies of one in every --latency_sample_rate operations of each thread
+  struct CACHE_ALIGNED OperationLatencies {
+    LatencyHistogram reads;
+    LatencyHistogram acquire_releases;
+  };
+  std::vector<std::unique_ptr<OperationLatencies>> latencies;
+
+  // Prints latency percentiles of the sampled operations of all threads
+  void ReportLatencies();
+
+  // Successes so far of each thread, published as they happen with
+  // --interval_ms so that the main thread can sample them
+  struct CACHE_ALIGNED Progress {
+    std::atomic<uint64_t> successes{0};
+  };
+  std::vector<std::unique_ptr<Progress>> progress;
+
+  // Per-thread successes in each interval of --interval_ms
+  struct Interval {
+    double end_ms;  // Since the start of the benchmark
+    double length_ms;
+    uint32_t phase;    // Phase at the end of the interval
+    uint32_t threads;  // Threads active in that phase
+    std::vector<uint64_t> successes;
+
+    // Jain's fairness index over the active threads: 1 if all of them
+    // progressed equally, 1/threads if only one did; undefined if none did
+    double Jain() const;
+  };
+  std::vector<Interval> intervals;
+
+  // Sleeps for the benchmark duration, sampling progress every --interval_ms
+  // and switching phases at their start times
+  void SampleIntervals();
+
+  // Prints throughput and Jain's fairness index of each interval
+  void ReportIntervals();
+
   // Benchmark start barrier: worker threads can only proceed if set to true
   std::atomic<bool> bench_start_barrier;
 
   // Thread start barrier: a counter of "ready-to-start" threads
   std::atomic<uint32_t> thread_start_barrier;
 
+  // Thread finish barrier: a counter of threads done with the round
+  std::atomic<uint32_t> thread_finish_barrier;
+
+  // Workers not needed by the current round (or between rounds) sleep here
+  std::mutex round_mutex;
+  std::condition_variable round_cv;
+  uint64_t round;
+  bool exiting;
+
   // Whether the benchmark should stop and worker threads should shutdown
   std::atomic<bool> shutdown;
 
   // List of all worker threads
   std::vector<std::thread *> workers;
 
-  // Number of worker threads
+  // Number of worker threads (in the current round)
   uint32_t nthreads;
 
   // Benchmark duration in seconds
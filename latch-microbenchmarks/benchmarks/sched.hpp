@@ -1,66 +1,27 @@
 #pragma once
 
-#include <iostream>
-
-/*
-static constexpr size_t cpu_ids[] = {
-   0,  2,  4,  6,  8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30, 32, 34, 36, 38,
-   1,  3,  5,  7,  9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31, 33, 35, 37, 39,
-  40, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62, 64, 66, 68, 70, 72, 74, 76, 78,
-  41, 43, 45, 47, 49, 51, 53, 55, 57, 59, 61, 63, 65, 67, 69, 71, 73, 75, 77, 79,
-};
-*/
-
-/*
-static constexpr size_t cpu_ids[] = {
-   0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
-   20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32,33, 34, 35, 36, 37, 38, 39,
-   40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 
-   60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79,
-};
-*/
+#include <gflags/gflags.h>
 
+#include <iostream>
 
-static constexpr size_t cpu_ids[] = {
-   0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30, 32, 34, 36, 38, 
-   1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31, 33, 35, 37, 39, 
-   40, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62, 64, 66, 68, 70, 72, 74, 76, 78,
-   41, 43, 45, 47, 49, 51, 53, 55, 57, 59, 61, 63, 65, 67, 69, 71, 73, 75, 77, 79,
-};
-
-static constexpr size_t node_ids[] = {
-   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-};
+#include "../../index-benchmarks/common/topology.h"
 
-/*
- * For dis 2/3 which has 2x24 cores. 
-static constexpr size_t cpu_ids[] = {
-   0,  2,  4,  6,  8,  10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30, 32, 34, 36, 38, 40, 42, 44, 46,
-   1,  3,  5,  7,  9,  11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31, 33, 35, 37, 39, 41, 43, 45, 47,
-   48, 50, 52, 54, 56, 58, 60, 62, 64, 66, 68, 70, 72, 74, 76, 78, 80, 82, 84, 86, 88, 90, 92, 94, 
-   49, 51, 53, 55, 57, 59, 61, 63, 65, 67, 69, 71, 73, 75, 77, 79, 81, 83, 85, 87, 89, 91, 93, 95,
-};
+DECLARE_string(pin);
 
-static constexpr size_t node_ids[] = {
-   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-};
-*/
+// Placement policy of --pin, parsed once
+static topology::policy pin_policy() {
+  static topology::policy p = [] {
+    topology::policy p = topology::policy::kSmtLast;
+    topology::parse_policy(FLAGS_pin, p);
+    return p;
+  }();
+  return p;
+}
 
 static void set_affinity(uint32_t thread_id) {
-  int my_cpu_id = cpu_ids[thread_id % (sizeof(cpu_ids) / sizeof(cpu_ids[0]))];
-  cpu_set_t my_set;
-  CPU_ZERO(&my_set);
-  CPU_SET(my_cpu_id, &my_set);
-  sched_setaffinity(0, sizeof(cpu_set_t), &my_set);
-  //std::cout << "Pinned thread " << thread_id << " to CPU " << my_cpu_id << std::endl;
+  topology::pin(thread_id, pin_policy());
 }
 
 static size_t get_node_id(uint32_t thread_id) {
-   return node_ids[thread_id % (sizeof(node_ids) / sizeof(node_ids[0]))];
+  return topology::node_of(thread_id, pin_policy());
 }
@@ -0,0 +1,33 @@
+#include "bench_config.hpp"
+#include "shfl_bench.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+bool ShflBench::LatchVersionRead(size_t node, size_t idx) {
+  Latch *latch = GetLatch(node, idx);
+  return false;
+}
+
+void ShflBench::LatchAcquireRelease(size_t node, size_t idx) {
+  Latch *latch = GetLatch(node, idx);
+  QNode q;
+
+  uint64_t start = FLAGS_handoff_stats ? __rdtsc() : 0;
+  latch->lock(&q);
+  AfterAcquire(node, idx, start);
+  CriticalSection(node, idx, true);
+  BeforeRelease(node, idx);
+  latch->unlock();
+}
+
+int main(int argc, char **argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  ShflBench test;
+  test.Run();
+
+  return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "latches/ShflLock.h"
+#include "perf.hpp"
+
+struct ShflBench : public Bench<shfl::ShflLock> {
+  using Latch = shfl::ShflLock;
+  using QNode = shfl::ShflQNode;
+
+  // Constructor
+  ShflBench() : Bench<shfl::ShflLock>() {}
+
+  // Destructor
+  ~ShflBench() {}
+
+  // Version read operation
+  bool LatchVersionRead(size_t node, size_t idx) override;
+
+  // Acquire-release operation
+  void LatchAcquireRelease(size_t node, size_t idx) override;
+};
@@ -7,7 +7,8 @@
 bool STDRWBench::LatchVersionRead(size_t node, size_t idx) {
   Latch *latch = GetLatch(node, idx);
   latch->read_lock();
-  CriticalSection();
+  CriticalSection(node, idx, false);
+  VerifyRead();
   latch->read_unlock();
   return true;
 }
@@ -15,7 +16,7 @@ bool STDRWBench::LatchVersionRead(size_t node, size_t idx) {
 void STDRWBench::LatchAcquireRelease(size_t node, size_t idx) {
   Latch *latch = GetLatch(node, idx);
   latch->lock();
-  CriticalSection();
+  CriticalSection(node, idx, true);
   latch->unlock();
 }
 
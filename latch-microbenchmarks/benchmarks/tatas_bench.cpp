@@ -12,7 +12,7 @@ bool TATASBench::LatchVersionRead(size_t node, size_t idx) {
 void TATASBench::LatchAcquireRelease(size_t node, size_t idx) {
   Latch *latch = GetLatch(node, idx);
   latch->lock();
-  CriticalSection();
+  CriticalSection(node, idx, true);
   latch->unlock();
 }
 
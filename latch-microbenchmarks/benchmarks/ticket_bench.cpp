@@ -0,0 +1,52 @@
+#include "bench_config.hpp"
+#include "ticket_bench.hpp"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+bool TicketBench::LatchVersionRead(size_t node, size_t idx) {
+  Latch *latch = GetLatch(node, idx);
+#if defined(TICKET_OPT_READ)
+  bool restart = false;
+  uint64_t v = latch->try_begin_read(restart);
+  if (restart) {
+    return false;
+  }
+  CriticalSection(node, idx, false);
+  if (!latch->validate_read(v)) {
+    return false;
+  }
+  VerifyRead();
+  return true;
+#else
+  return false;
+#endif
+}
+
+void TicketBench::LatchAcquireRelease(size_t node, size_t idx) {
+  Latch *latch = GetLatch(node, idx);
+
+  uint64_t start = FLAGS_handoff_stats ? __rdtsc() : 0;
+  latch->lock();
+  AfterAcquire(node, idx, start);
+  CriticalSection(node, idx, true);
+  BeforeRelease(node, idx);
+  latch->unlock();
+}
+
+#if defined(TICKET_OPT_READ)
+void TicketBench::LatchLock(size_t node, size_t idx) { GetLatch(node, idx)->lock(); }
+
+void TicketBench::LatchUnlock(size_t node, size_t idx) { GetLatch(node, idx)->unlock(); }
+#endif
+
+int main(int argc, char **argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  TicketBench test;
+  test.Run();
+
+  return 0;
+}
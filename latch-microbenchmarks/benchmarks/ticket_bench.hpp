@@ -0,0 +1,30 @@
+#pragma once
+
+#include "latches/Ticket.h"
+#include "perf.hpp"
+
+struct TicketBench : public Bench<ticket::TicketLock> {
+  using Latch = ticket::TicketLock;
+
+  // Constructor
+  TicketBench() : Bench<ticket::TicketLock>() {
+#if !defined(TICKET_OPT_READ)
+    LOG_IF(FATAL, FLAGS_depth > 1) << "Lock coupling (--depth > 1) needs TICKET_OPT_READ";
+#endif
+  }
+
+  // Destructor
+  ~TicketBench() {}
+
+  // Version read operation
+  bool LatchVersionRead(size_t node, size_t idx) override;
+
+  // Acquire-release operation
+  void LatchAcquireRelease(size_t node, size_t idx) override;
+
+#if defined(TICKET_OPT_READ)
+  // Lock coupling primitives
+  void LatchLock(size_t node, size_t idx) override;
+  void LatchUnlock(size_t node, size_t idx) override;
+#endif
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <immintrin.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace clh {
+
+#ifndef CACHELINE_SIZE
+#define CACHELINE_SIZE 64
+#endif
+
+struct alignas(CACHELINE_SIZE) CLHQNode {
+  // Set while the owner holds or waits for the lock
+  std::atomic<uint64_t> locked_{0};
+
+  // Node the owner spins on, and takes over in unlock()
+  CLHQNode *pred_ = nullptr;
+};
+
+/*
+ * CLH queue lock (Craig; Magnussen, Landin and Hagersten).
+ *
+ * Like MCS, waiters form a queue through the tail pointer, but each waiter
+ * spins on its predecessor's node instead of its own, so releasing the lock is
+ * a single store and needs no successor pointer. The price is that nodes
+ * migrate: unlock() leaves the caller's node to its successor and hands back
+ * the predecessor's node for the next lock(). Callers thus keep a node pointer
+ * rather than a node, and on NUMA machines a waiter spins on memory that was
+ * last written on another socket.
+ *
+ * The queue starts with a released node kept in the lock, which then
+ * migrates like any other: the lock's memory must stay valid as long as the
+ * threads that used it lock anything. The lock takes two cache lines.
+ */
+class CLHLock {
+ private:
+  CLHQNode initial_;
+  std::atomic<CLHQNode *> tail_{&initial_};
+
+ public:
+  CLHLock() = default;
+
+  CLHLock(const CLHLock &) = delete;
+  CLHLock &operator=(const CLHLock &) = delete;
+
+  inline void lock(CLHQNode *qnode) {
+    qnode->locked_.store(1, std::memory_order_relaxed);
+    CLHQNode *pred = tail_.exchange(qnode);
+    qnode->pred_ = pred;
+
+    while (pred->locked_.load(std::memory_order_acquire)) {
+      _mm_pause();
+    }
+  }
+
+  // Returns the node to pass to the next lock()
+  inline CLHQNode *unlock(CLHQNode *qnode) {
+    CLHQNode *pred = qnode->pred_;
+    qnode->locked_.store(0, std::memory_order_release);
+    return pred;
+  }
+};
+
+}  // namespace clh
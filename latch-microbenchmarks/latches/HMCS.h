@@ -0,0 +1,135 @@
+#pragma once
+
+#include <immintrin.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "../../index-benchmarks/common/topology.h"
+
+namespace hmcs {
+
+#ifndef CACHELINE_SIZE
+#define CACHELINE_SIZE 64
+#endif
+
+// Number of per-socket queues in each lock; threads on sockets beyond this
+// share queues (socket % HMCS_MAX_SOCKETS)
+#ifndef HMCS_MAX_SOCKETS
+#define HMCS_MAX_SOCKETS 4
+#endif
+
+// Fairness bound: the maximum number of consecutive lock holders from one
+// socket before the global queue moves on to the other sockets
+#ifndef HMCS_MAX_LOCAL_HANDOFFS
+#define HMCS_MAX_LOCAL_HANDOFFS 64
+#endif
+
+struct alignas(CACHELINE_SIZE) HMCSQNode {
+  std::atomic<HMCSQNode *> next_{nullptr};
+
+  // Waiting, told to acquire the global lock, or the number of holders from
+  // this socket so far (the global lock was passed along with the local one)
+  std::atomic<uint64_t> status_{0};
+};
+
+/*
+ * Two-level hierarchical MCS lock (HMCS, Chabbi et al., PPoPP'15).
+ *
+ * Threads queue in an MCS lock of their socket, and the head of each local
+ * queue queues in a global MCS lock on behalf of its socket. A holder with a
+ * local successor passes both locks at once by writing its successor's status,
+ * for up to HMCS_MAX_LOCAL_HANDOFFS holders; then it releases the global lock
+ * and tells its local successor to queue for it again. Unlike the cohort OMCS
+ * lock, every level is a queue lock, so the global lock is handed over in
+ * FIFO order of the sockets too.
+ *
+ * Each socket queues globally with a node of its own, kept in the lock: it is
+ * used by one holder of the local lock after another, so it can't belong to
+ * any of their threads. The lock thus takes 1 + HMCS_MAX_SOCKETS cache lines.
+ */
+class HMCSLock {
+ public:
+  static constexpr uint32_t kMaxSockets = HMCS_MAX_SOCKETS;
+  static constexpr uint64_t kMaxLocalHandoffs = HMCS_MAX_LOCAL_HANDOFFS;
+  static_assert(kMaxSockets > 0);
+  static_assert(kMaxLocalHandoffs > 0);
+
+ private:
+  static constexpr uint64_t kWait = ~0ull;
+  static constexpr uint64_t kAcquireParent = kWait - 1;
+  static constexpr uint64_t kCohortStart = 1;
+
+  std::atomic<HMCSQNode *> global_tail_{nullptr};
+  std::atomic<HMCSQNode *> local_tails_[kMaxSockets]{};
+  HMCSQNode socket_qnodes_[kMaxSockets];
+
+  // Socket of the calling thread, as far as this lock tells them apart
+  static inline uint32_t current_socket() { return topology::current_node() % kMaxSockets; }
+
+  // MCS acquire: returns what the predecessor stored on release, or
+  // kCohortStart without a predecessor
+  static inline uint64_t acquire(std::atomic<HMCSQNode *> &tail, HMCSQNode *qnode) {
+    qnode->next_.store(nullptr, std::memory_order_relaxed);
+    qnode->status_.store(kWait, std::memory_order_relaxed);
+    HMCSQNode *pred = tail.exchange(qnode);
+    if (!pred) {
+      qnode->status_.store(kCohortStart, std::memory_order_relaxed);
+      return kCohortStart;
+    }
+    pred->next_.store(qnode, std::memory_order_release);
+    uint64_t status;
+    while ((status = qnode->status_.load(std::memory_order_acquire)) == kWait) {
+      _mm_pause();
+    }
+    return status;
+  }
+
+  // MCS release, storing [status] into the successor
+  static inline void release(std::atomic<HMCSQNode *> &tail, HMCSQNode *qnode, uint64_t status) {
+    HMCSQNode *succ = qnode->next_.load(std::memory_order_acquire);
+    if (!succ) {
+      HMCSQNode *self = qnode;
+      if (tail.compare_exchange_strong(self, nullptr)) {
+        return;
+      }
+      while (!(succ = qnode->next_.load(std::memory_order_acquire))) {
+        _mm_pause();
+      }
+    }
+    succ->status_.store(status, std::memory_order_release);
+  }
+
+ public:
+  HMCSLock() = default;
+
+  HMCSLock(const HMCSLock &) = delete;
+  HMCSLock &operator=(const HMCSLock &) = delete;
+
+  inline void lock(HMCSQNode *qnode) {
+    uint32_t socket = current_socket();
+    uint64_t status = acquire(local_tails_[socket], qnode);
+    if (status != kCohortStart && status != kAcquireParent) {
+      // Passed along with the global lock
+      return;
+    }
+    qnode->status_.store(kCohortStart, std::memory_order_relaxed);
+    acquire(global_tail_, &socket_qnodes_[socket]);
+  }
+
+  inline void unlock(HMCSQNode *qnode) {
+    uint32_t socket = current_socket();
+    uint64_t status = qnode->status_.load(std::memory_order_relaxed);
+    if (status < kMaxLocalHandoffs) {
+      HMCSQNode *succ = qnode->next_.load(std::memory_order_acquire);
+      if (succ) {
+        succ->status_.store(status + 1, std::memory_order_release);
+        return;
+      }
+    }
+    release(global_tail_, &socket_qnodes_[socket], kCohortStart);
+    release(local_tails_[socket], qnode, kAcquireParent);
+  }
+};
+
+}  // namespace hmcs
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../index-benchmarks/latches/OMCSCohort.h"
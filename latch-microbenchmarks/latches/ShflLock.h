@@ -0,0 +1,152 @@
+#pragma once
+
+#include <immintrin.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "../../index-benchmarks/common/topology.h"
+
+namespace shfl {
+
+#ifndef CACHELINE_SIZE
+#define CACHELINE_SIZE 64
+#endif
+
+// Fairness bound: the maximum number of consecutive queue heads from one
+// socket that shuffle waiters of their socket ahead of the others
+#ifndef SHFLLOCK_MAX_BATCH
+#define SHFLLOCK_MAX_BATCH 64
+#endif
+
+struct alignas(CACHELINE_SIZE) ShflQNode {
+  std::atomic<ShflQNode *> next_{nullptr};
+  std::atomic<uint64_t> head_{0};
+
+  // Written by the owner before queueing; read by shufflers
+  uint32_t socket_ = 0;
+
+  // Number of heads from this node's socket in a row ahead of it, as set by
+  // the shuffler that moved it (0 if none did)
+  std::atomic<uint64_t> batch_{0};
+};
+
+/*
+ * Non-blocking ShflLock (Kashyap et al., "Scalable and Practical Locking with
+ * Shuffling", SOSP'19).
+ *
+ * The lock is a test-and-set word that a thread takes right away if nobody
+ * queues, decoupled from an MCS-style queue of waiters. Only the head of the
+ * queue spins on the lock word; while it waits, it shuffles the queue behind
+ * it, moving waiters of its own socket up to form a group right after it, so
+ * that the lock tends to stay on one socket without a per-socket structure in
+ * the lock. A head whose predecessors already came from its socket
+ * SHFLLOCK_MAX_BATCH times in a row leaves the queue as is.
+ *
+ * Shuffling happens off the critical path and touches only queue nodes behind
+ * the head; the node at the tail is never moved, since a newcomer may be
+ * linking itself to it. Releasing the lock is a single store and needs no
+ * queue node. The lock takes 16 bytes.
+ */
+class ShflLock {
+ public:
+  static constexpr uint64_t kMaxBatch = SHFLLOCK_MAX_BATCH;
+
+ private:
+  std::atomic<uint32_t> locked_{0};
+  std::atomic<ShflQNode *> tail_{nullptr};
+
+  inline bool try_lock_word() {
+    uint32_t expected = 0;
+    return locked_.load(std::memory_order_relaxed) == 0 &&
+           locked_.compare_exchange_strong(expected, 1);
+  }
+
+  // Moves the waiters of [head]'s socket right behind it (and behind each
+  // other), until the queue ends or the lock word is released
+  inline void shuffle(ShflQNode *head) {
+    uint64_t batch = head->batch_.load(std::memory_order_relaxed);
+    if (batch >= kMaxBatch) {
+      return;
+    }
+    ShflQNode *last = head;  // Last node of the group
+    ShflQNode *prev = head;
+    while (locked_.load(std::memory_order_relaxed)) {
+      ShflQNode *curr = prev->next_.load(std::memory_order_acquire);
+      if (!curr || curr == tail_.load(std::memory_order_acquire)) {
+        return;
+      }
+      if (curr->socket_ != head->socket_) {
+        prev = curr;
+        continue;
+      }
+      if (prev == last) {
+        // Already in place
+        curr->batch_.store(batch + 1, std::memory_order_relaxed);
+        last = prev = curr;
+        continue;
+      }
+      ShflQNode *next = curr->next_.load(std::memory_order_acquire);
+      if (!next) {
+        return;
+      }
+      curr->batch_.store(batch + 1, std::memory_order_relaxed);
+      prev->next_.store(next, std::memory_order_relaxed);
+      curr->next_.store(last->next_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      last->next_.store(curr, std::memory_order_release);
+      last = curr;
+    }
+  }
+
+ public:
+  ShflLock() = default;
+
+  ShflLock(const ShflLock &) = delete;
+  ShflLock &operator=(const ShflLock &) = delete;
+
+  inline void lock(ShflQNode *qnode) {
+    if (!tail_.load(std::memory_order_relaxed) && try_lock_word()) {
+      return;
+    }
+
+    qnode->next_.store(nullptr, std::memory_order_relaxed);
+    qnode->head_.store(0, std::memory_order_relaxed);
+    qnode->socket_ = topology::current_node();
+    qnode->batch_.store(0, std::memory_order_relaxed);
+    ShflQNode *pred = tail_.exchange(qnode);
+    if (pred) {
+      pred->next_.store(qnode, std::memory_order_release);
+      while (!qnode->head_.load(std::memory_order_acquire)) {
+        _mm_pause();
+      }
+    }
+
+    // Head of the queue
+    bool shuffled = false;
+    while (!try_lock_word()) {
+      if (!shuffled) {
+        shuffle(qnode);
+        shuffled = true;
+      } else {
+        _mm_pause();
+      }
+    }
+
+    // Make the successor the head
+    ShflQNode *succ = qnode->next_.load(std::memory_order_acquire);
+    if (!succ) {
+      ShflQNode *self = qnode;
+      if (tail_.compare_exchange_strong(self, nullptr)) {
+        return;
+      }
+      while (!(succ = qnode->next_.load(std::memory_order_acquire))) {
+        _mm_pause();
+      }
+    }
+    succ->head_.store(1, std::memory_order_release);
+  }
+
+  inline void unlock() { locked_.store(0, std::memory_order_release); }
+};
+
+}  // namespace shfl
@@ -4,6 +4,8 @@
 
 #include <atomic>
 
+#include "Backoff.h"
+
 class TATAS {
   std::atomic<uint64_t> lock_;
 
@@ -18,7 +20,7 @@ class TATAS {
       goto retry;
     }
     if (!lock_.compare_exchange_strong(locked, 1ul)) {
-      cas_failure++;
+      backoff::pause(++cas_failure);
       goto retry;
     }
   }
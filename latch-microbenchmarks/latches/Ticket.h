@@ -0,0 +1,81 @@
+#pragma once
+
+#include <immintrin.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "Backoff.h"
+
+namespace ticket {
+
+/*
+ * Ticket lock (Mellor-Crummey and Scott, TOCS'91) with proportional backoff,
+ * in a single word:
+ *
+ * |---63-32---|---31-0----|
+ * |next ticket|now serving|
+ *
+ * The lock is free iff both halves are equal. Every acquire bumps the next
+ * ticket and every release bumps now serving, so the word doubles as a version:
+ * a snapshot with equal halves from try_begin_read() validates iff no writer
+ * acquired the lock since. This is what the optimistic ticket lock benchmark
+ * (TICKET_OPT_READ) measures; keeping both counters in one word makes waiters
+ * re-read a line that every new arrival writes to, unlike the classic layout.
+ */
+class TicketLock {
+ private:
+  static constexpr uint64_t kTicket = 1ull << 32;
+  static constexpr uint64_t kServingMask = kTicket - 1;
+
+  static inline uint32_t next_ticket(const uint64_t word) { return word >> 32; }
+
+  static inline uint32_t now_serving(const uint64_t word) { return word & kServingMask; }
+
+  std::atomic<uint64_t> word_{0};
+
+ public:
+  static inline bool is_locked(const uint64_t word) {
+    return next_ticket(word) != now_serving(word);
+  }
+
+  TicketLock() = default;
+
+  TicketLock(const TicketLock &) = delete;
+  TicketLock &operator=(const TicketLock &) = delete;
+
+  inline void lock() {
+    uint32_t ticket = next_ticket(word_.fetch_add(kTicket));
+    while (true) {
+      uint32_t serving = now_serving(word_.load(std::memory_order_acquire));
+      if (serving == ticket) {
+        return;
+      }
+      // Wait in proportion to the number of holders ahead of us
+      backoff::ProportionalBackoff::pause(ticket - serving);
+    }
+  }
+
+  inline void unlock() {
+    // Only the holder writes now serving; wrap it around without carrying
+    // into the next ticket
+    uint64_t word = word_.load(std::memory_order_relaxed);
+    if (now_serving(word) == kServingMask) {
+      word_.fetch_sub(kServingMask);
+    } else {
+      word_.fetch_add(1);
+    }
+  }
+
+  inline uint64_t try_begin_read(bool &restart) const {
+    uint64_t word = word_.load(std::memory_order_acquire);
+    restart = is_locked(word);
+    return word;
+  }
+
+  inline bool validate_read(uint64_t version) const {
+    return word_.load(std::memory_order_acquire) == version;
+  }
+};
+
+}  // namespace ticket
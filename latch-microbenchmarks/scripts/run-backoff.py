@@ -0,0 +1,32 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import run_all_experiments
+
+# Backoff policies (see index-benchmarks/latches/Backoff.h) for centralized
+# locks that retry on a failed CAS.
+latches = ['optlock_faa', 'optlock_faa_backoff_exp', 'optlock_faa_backoff_prop', 'optlock_faa_backoff_rand',
+           'tatas_xchg', 'tatas_xchg_backoff_exp', 'tatas_xchg_backoff_prop', 'tatas_xchg_backoff_rand',
+           'omcs_offset']
+
+if __name__ == '__main__':
+    SECONDS = 10
+    cs_cycles = 50
+    ps_cycles = 0
+
+    threads = [1, 2, 5, 10, 20, 40, 80]
+
+    for (r, w) in [(0, 100), (80, 20)]:
+        run_all_experiments(latches, 'Latch-Backoff-1-Max-R{}-W{}'.format(r, w), threads, array_size=1, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles)
+        run_all_experiments(latches, 'Latch-Backoff-High-5-R{}-W{}'.format(r, w), threads, array_size=5, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles)
+        run_all_experiments(latches, 'Latch-Backoff-Medium-1000-R{}-W{}'.format(r, w), threads, array_size=1000, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles)
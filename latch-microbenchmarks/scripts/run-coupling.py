@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import run_all_experiments
+
+# Lock coupling needs optimistic reads
+coupling_latches = ['optlock_st', 'omcs_offset', 'omcs_offset_op_read_numa_qnode']
+
+if __name__ == '__main__':
+    SECONDS = 10
+    cs_cycles = 50
+    ps_cycles = 0
+    FANOUT = 16
+
+    threads = [1, 2, 5, 10, 20, 40, 80]
+
+    # Trees of 3 to 5 levels over 16^(depth - 1) leaves: one root, contended
+    # by every operation
+    for depth in [3, 4, 5]:
+        array_size = FANOUT ** (depth - 1)
+        for (r, w) in [(80, 20), (50, 50), (0, 100)]:
+            run_all_experiments(coupling_latches, 'Latch-Coupling-D{}-F{}-R{}-W{}'.format(depth, FANOUT, r, w), threads,
+                                array_size=array_size, seconds=SECONDS, ver_read_pct=r, acq_rel_pct=w, dist='uniform',
+                                depth=depth, fanout=FANOUT, cs_cycles=cs_cycles, ps_cycles=ps_cycles)
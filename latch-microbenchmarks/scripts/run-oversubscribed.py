@@ -0,0 +1,32 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import run_all_experiments
+
+# Spinning vs. spin-then-park queue waiters when there are more threads than
+# hardware threads, i.e., lock holders and predecessors get preempted.
+latches = ['omcs_offset', 'omcs_offset_park',
+           'omcs_offset_op_read_numa_qnode', 'omcs_offset_op_read_numa_qnode_park',
+           'mcs', 'tatas_st']
+
+if __name__ == '__main__':
+    SECONDS = 10
+    cs_cycles = 50
+    ps_cycles = 0
+
+    # Assume 2 hyperthreads per core
+    num_hts = NUM_SOCKETS * NUM_CORES * 2
+    threads = [num_hts // 2, num_hts, num_hts * 2, num_hts * 4]
+
+    for (r, w) in [(0, 100), (80, 20)]:
+        run_all_experiments(latches, 'Latch-Oversubscribed-1-Max-R{}-W{}'.format(r, w), threads, array_size=1, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles)
+        run_all_experiments(latches, 'Latch-Oversubscribed-High-5-R{}-W{}'.format(r, w), threads, array_size=5, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles)
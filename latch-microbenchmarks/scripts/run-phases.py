@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import run_all_experiments, rw_latches
+
+# Read burst, write burst, write burst on a zipfian hot set, then back to the
+# read burst with a quarter of the threads: how fast each latch (and adaptive
+# features such as op-read) recovers after the workload changes
+def phases(threads):
+    return ';'.join(['5000:mix=0:100',
+                     '10000:dist=zipfian',
+                     '15000:mix=90:10,dist=uniform,threads={}'.format(max(threads // 4, 1))])
+
+if __name__ == '__main__':
+    SECONDS = 20
+    cs_cycles = 50
+    ps_cycles = 0
+    ARRAY_SIZE = 30000
+
+    threads = [20, 80]
+
+    # The last phase depends on the thread count, so each count is its own run
+    for t in threads:
+        run_all_experiments(rw_latches, 'Latch-Phases-{}-T{}'.format(ARRAY_SIZE, t), [t],
+                            array_size=ARRAY_SIZE, seconds=SECONDS, ver_read_pct=90, acq_rel_pct=10,
+                            dist='uniform', skew=0.99, phases=phases(t), interval_ms=100,
+                            cs_cycles=cs_cycles, ps_cycles=ps_cycles)
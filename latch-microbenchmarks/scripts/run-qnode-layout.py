@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import run_all_experiments
+
+# Default (two cache line pairs) vs. compact (one cache line) queue nodes.
+# Handoff latency percentiles are printed at the end of each run's stdout file.
+latches = ['omcs_offset', 'omcs_offset_compact',
+           'omcs_offset_op_read_numa_qnode', 'omcs_offset_op_read_numa_qnode_compact',
+           'mcs', 'mcs_compact',
+           'mcsrw_offset', 'mcsrw_offset_compact']
+
+if __name__ == '__main__':
+    SECONDS = 10
+    cs_cycles = 50
+    ps_cycles = 0
+
+    threads = [1, 2, 5, 10, 20, 40, 80]
+
+    for (r, w) in [(0, 100), (80, 20)]:
+        run_all_experiments(latches, 'Latch-QNode-Layout-1-Max-R{}-W{}'.format(r, w), threads, array_size=1, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles, handoff_stats=1)
+        run_all_experiments(latches, 'Latch-QNode-Layout-High-5-R{}-W{}'.format(r, w), threads, array_size=5, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles, handoff_stats=1)
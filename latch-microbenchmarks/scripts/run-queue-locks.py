@@ -0,0 +1,30 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import run_all_experiments
+
+# Other queue locks against MCS and OptiQL: CLH, ticket, hierarchical MCS and
+# ShflLock for writers, and the ticket lock's version word for readers.
+wo_latches = ['mcs', 'clh', 'ticket', 'hmcs', 'shfl', 'omcs_offset']
+rw_latches = ['ticket_opt_read', 'optlock_st', 'omcs_offset_op_read_numa_qnode']
+
+if __name__ == '__main__':
+    SECONDS = 10
+    cs_cycles = 50
+    ps_cycles = 0
+
+    threads = [1, 2, 5, 10, 20, 40, 80]
+
+    for (r, w) in [(0, 100), (80, 20)]:
+        latches = wo_latches + rw_latches if r == 0 else rw_latches
+        run_all_experiments(latches, 'Latch-Queue-1-Max-R{}-W{}'.format(r, w), threads, array_size=1, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles)
+        run_all_experiments(latches, 'Latch-Queue-High-5-R{}-W{}'.format(r, w), threads, array_size=5, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles)
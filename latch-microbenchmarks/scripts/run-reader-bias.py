@@ -0,0 +1,28 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import run_all_experiments
+
+# MCS-RW with the shared reader count vs. BRAVO-style visible reader slots,
+# with OptiQL as the optimistic baseline.
+latches = ['mcsrw_offset', 'mcsrw_offset_bravo', 'omcs_offset_op_read_numa_qnode']
+
+if __name__ == '__main__':
+    SECONDS = 10
+    cs_cycles = 50
+    ps_cycles = 0
+
+    threads = [1, 2, 5, 10, 20, 40, 80]
+
+    for (r, w) in [(100, 0), (99, 1), (90, 10), (80, 20)]:
+        run_all_experiments(latches, 'Latch-Reader-Bias-1-Max-R{}-W{}'.format(r, w), threads, array_size=1, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles)
+        run_all_experiments(latches, 'Latch-Reader-Bias-High-5-R{}-W{}'.format(r, w), threads, array_size=5, seconds=SECONDS,
+                            ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles)
@@ -0,0 +1,33 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import run_all_experiments, rw_latches, wo_latches
+
+# Skewed latch indexes: zipfian (theta), self-similar (h) and a moving hotspot
+# (hot fraction h), between the uniform and the single-latch extremes.
+distributions = [('zipfian', [0.5, 0.9, 0.99]),
+                 ('selfsimilar', [0.2, 0.1]),
+                 ('hotspot', [0.2, 0.01])]
+
+if __name__ == '__main__':
+    SECONDS = 10
+    cs_cycles = 50
+    ps_cycles = 0
+    ARRAY_SIZE = 30000
+
+    threads = [1, 2, 5, 10, 20, 40, 80]
+
+    for (r, w) in [(0, 100), (80, 20)]:
+        latches = rw_latches + wo_latches if r == 0 else rw_latches
+        for dist, skews in distributions:
+            for skew in skews:
+                run_all_experiments(latches, 'Latch-{}-{}-{}-R{}-W{}'.format(dist.capitalize(), skew, ARRAY_SIZE, r, w), threads,
+                                    array_size=ARRAY_SIZE, seconds=SECONDS, ver_read_pct=r, acq_rel_pct=w, dist=dist, skew=skew,
+                                    hotspot_period_ms=1000, cs_cycles=cs_cycles, ps_cycles=ps_cycles)
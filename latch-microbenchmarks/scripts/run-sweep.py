@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+
+import json
+import os
+import subprocess
+import sys
+
+import matplotlib.pyplot as plt
+import pandas as pd
+import seaborn as sns
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import relative_stddev, rw_latches, wo_latches
+
+NUM_REPLICATES = 5
+
+
+def run_sweep(latches, name, threads, cs_cycles, mixes, **kwargs):
+    # Don't move this file
+    repo_dir = os.path.abspath(os.path.dirname(os.path.dirname(__file__)))
+
+    # One process per latch and replicate runs every configuration of the
+    # sweep, as rounds over the same latches and threads
+    sweep_args = ['--sweep_threads={}'.format(','.join(map(str, threads))),
+                  '--sweep_cs_cycles={}'.format(','.join(map(str, cs_cycles))),
+                  '--sweep_mixes={}'.format(','.join('{}:{}'.format(r, w) for (r, w) in mixes))]
+    args = ['--{}={}'.format(k, w) for k, w in kwargs.items()]
+    upto = min((max(threads) + NUM_CORES - 1) // NUM_CORES, NUM_SOCKETS)
+    numactl = ['numactl', '--membind={}'.format(','.join(map(str, range(upto))))]
+
+    rounds = len(threads) * len(cs_cycles) * len(mixes)
+    print('Estimated time:', len(latches) * NUM_REPLICATES * rounds * kwargs['seconds'] // 60, 'minutes')
+
+    rows = []
+    for replica in range(1, NUM_REPLICATES + 1):
+        for latch in latches:
+            bench_bin = os.path.join(repo_dir, 'build/benchmarks/{}_bench'.format(latch))
+            if not os.access(bench_bin, os.X_OK):
+                print('binary not found:', bench_bin)
+                return
+
+            fname = '{}-{}-{}.json'.format(name, latch, replica)
+            commands = [*numactl, bench_bin, *sweep_args, *args, '--json={}'.format(fname)]
+            print('Executing:', ' '.join(commands))
+            if os.path.exists(fname):
+                print('Skipping')
+            else:
+                subprocess.run(commands, check=True, stdout=subprocess.DEVNULL)
+
+            with open(fname) as f:
+                result = json.load(f)
+            for r in result['rounds']:
+                row = {'latch': latch, 'replicate': replica}
+                row.update({k: r['parameters'][k] for k in ['cs_cycles', 'ver_read_pct', 'acq_rel_pct']})
+                row.update({k: v for k, v in r['results'].items() if not isinstance(v, (list, dict))})
+                rows.append(row)
+
+    df = pd.DataFrame(rows)
+    df.to_csv(f'{name}.csv')
+
+    keys = ['ver_read_pct', 'acq_rel_pct', 'cs_cycles', 'latch', 'threads']
+    df_digest = df.groupby(keys).agg(['mean', 'min', 'max', relative_stddev])['successes_per_second']
+    print(df_digest)
+    df_digest.to_csv(f'{name}-digest.csv')
+
+    # One plot of throughput against threads per critical section length and mix
+    for (r, w) in mixes:
+        for cs in cs_cycles:
+            plot_df = df[(df['ver_read_pct'] == r) & (df['acq_rel_pct'] == w) & (df['cs_cycles'] == cs)]
+            fig, ax = plt.subplots()
+            fig.set_size_inches(16, 6, forward=True)
+            g = sns.lineplot(x='threads', y='successes_per_second', hue='latch', data=plot_df, ax=ax,
+                             err_style='bars', marker='.', ci='sd', markersize=10)
+            g.set_xticks(threads)
+            g.set(xlabel='Number of threads', ylabel='Throughput')
+            ax.grid(axis='y', alpha=0.4)
+            plt.savefig(f'{name}-C{cs}-R{r}-W{w}.pdf', format='pdf', bbox_inches='tight')
+            plt.close(fig)
+
+
+if __name__ == '__main__':
+    SECONDS = 10
+    ps_cycles = 0
+
+    threads = [1, 2, 5, 10, 20, 40, 80]
+    cs_cycles = [50, 500, 5000]
+    mixes = [(80, 20), (50, 50), (0, 100)]
+
+    run_sweep(rw_latches, 'Latch-Sweep-High-5', threads, cs_cycles, mixes,
+              array_size=5, seconds=SECONDS, dist='uniform', ps_cycles=ps_cycles)
+    run_sweep(wo_latches, 'Latch-Sweep-High-5-WO', threads, cs_cycles, [(0, 100)],
+              array_size=5, seconds=SECONDS, dist='uniform', ps_cycles=ps_cycles)
@@ -0,0 +1,30 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+
+base_repo_dir = os.path.dirname(os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__))))
+sys.path.append(base_repo_dir)
+from common.numa import NUM_SOCKETS, NUM_CORES
+
+from run import run_all_experiments
+
+# Timed (abortable) queue waiters under high contention. Acquire latency
+# percentiles are printed at the end of each run's stdout file.
+latches = ['omcs_offset_abortable', 'omcs_offset_op_read_numa_qnode_abortable']
+
+if __name__ == '__main__':
+    SECONDS = 10
+    cs_cycles = 50
+    ps_cycles = 0
+
+    threads = [1, 2, 5, 10, 20, 40, 80]
+
+    # 0 waits without timeout
+    for timeout_cycles in [0, 1000, 10000, 100000]:
+        for (r, w) in [(0, 100), (80, 20)]:
+            run_all_experiments(latches, 'Latch-Timeout-{}-1-Max-R{}-W{}'.format(timeout_cycles, r, w), threads, array_size=1, seconds=SECONDS,
+                                ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles, timeout_cycles=timeout_cycles)
+            run_all_experiments(latches, 'Latch-Timeout-{}-High-5-R{}-W{}'.format(timeout_cycles, r, w), threads, array_size=5, seconds=SECONDS,
+                                ver_read_pct=r, acq_rel_pct=w, dist='uniform', cs_cycles=cs_cycles, ps_cycles=ps_cycles, timeout_cycles=timeout_cycles)
@@ -32,6 +32,7 @@ class LatchExperiment:
         self.threads = kwargs['threads']
         self.args = []
         self.results = []
+        self.timeseries = []
         self.raw_outputs = []
         for k, w in kwargs.items():
             self.args.append('--{}={}'.format(k, w))
@@ -100,6 +101,24 @@ class LatchExperiment:
 
         self.results.append(parse_output(result_text))
 
+        # Time series of runs with --interval_ms: (interval, time_ms,
+        # successes/s, jain) per interval
+        def parse_timeseries(text):
+            rows = []
+            in_series = False
+            for line in text.split('\n'):
+                if line.startswith('Time series'):
+                    in_series = True
+                elif in_series and line.startswith('='):
+                    break
+                elif in_series and re.match(r'\d+,', line):
+                    fields = line.split(',')
+                    rows.append((int(fields[0]), float(fields[1]),
+                                 float(fields[2]), float(fields[3])))
+            return rows
+
+        self.timeseries.append(parse_timeseries(result_text))
+
 
 def run_all_experiments(latches, name, threads, *args, **kwargs):
     # Don't move this file
@@ -183,6 +202,35 @@ def run_all_experiments(latches, name, threads, *args, **kwargs):
     g.set_xticks(threads, labels=threads)
     plt.savefig(f'{name}-logscale.pdf', format='pdf', bbox_inches='tight')
 
+    if kwargs.get('interval_ms'):
+        plot_timeseries(experiments, latches, threads, name)
+
+
+def plot_timeseries(experiments, latches, threads, name):
+    ts_columns = ['latch', 'thread', 'replicate',
+                  'interval', 'time_ms', 'successes', 'jain']
+    rows = []
+    for exp, (latch, t) in zip(experiments, [(latch, t) for latch in latches for t in threads]):
+        for rid, series in enumerate(exp.timeseries):
+            for row in series:
+                rows.append([latch, t, rid + 1, *row])
+    df = pd.DataFrame(rows, columns=ts_columns)
+    df.to_csv(f'{name}-timeseries.csv')
+
+    # Throughput and fairness over time at the highest thread count
+    plot_df = df[df['thread'] == max(threads)]
+    fig, (ax1, ax2) = plt.subplots(2, 1, sharex=True)
+    fig.set_size_inches(16, 8, forward=True)
+    for latch in latches:
+        latch_df = plot_df[plot_df['latch'] == latch]
+        sns.lineplot(x='time_ms', y='successes', data=latch_df,
+                     label=latch, ax=ax1, ci='sd')
+        sns.lineplot(x='time_ms', y='jain', data=latch_df,
+                     label=latch, ax=ax2, ci='sd')
+    ax1.set(ylabel='Throughput')
+    ax2.set(xlabel='Time (ms)', ylabel="Jain's fairness index", ylim=(0, 1.05))
+    plt.savefig(f'{name}-timeseries.pdf', format='pdf', bbox_inches='tight')
+
 rw_latches = ['optlock_st', 'omcs_offset', 'omcs_offset_op_read_numa_qnode',
               'stdrw', 'mcsrw_offset']
 wo_latches = ['tatas_st', 'mcs']